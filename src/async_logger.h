@@ -0,0 +1,82 @@
+#pragma once
+
+#include <bits/stdc++.h>
+
+// Writes log records from a dedicated thread, so that the threads producing them don't format
+// them or write files, let alone while holding locks.
+//
+// The records are passed through a lock-free multi-producer single-consumer queue: a linked list
+// where the producers exchange the head and then link the previous head to the new node, and the
+// consumer follows the links from the tail (Vyukov's MPSC queue). push() never blocks. The
+// logger thread writes the records in the order they are pushed, each with a single call to
+// `write`, so the records from different threads never interleave. It calls `flush` whenever
+// the queue is drained, and polls the queue every IDLE_MILLISECONDS milliseconds when it's empty.
+template <typename Record>
+class AsyncLogger {
+ public:
+  AsyncLogger(std::function<void(const Record&)> write_, std::function<void()> flush_)
+      : write(std::move(write_)),
+        flush(std::move(flush_)),
+        head(&stub),
+        tail(&stub),
+        logger_thread(&AsyncLogger::run, this) {}
+  AsyncLogger(const AsyncLogger&) = delete;
+  AsyncLogger& operator=(const AsyncLogger&) = delete;
+
+  // Writes the remaining records and stops the logger thread. All push() calls must have returned.
+  ~AsyncLogger() {
+    stopping.store(true, std::memory_order_release);
+    logger_thread.join();
+  }
+
+  // Queues the record to be written. Thread safe and lock-free.
+  void push(Record record) {
+    Node* node = new Node{{nullptr}, std::move(record)};
+    Node* prev = head.exchange(node, std::memory_order_acq_rel);
+    prev->next.store(node, std::memory_order_release);
+  }
+
+ private:
+  static constexpr int IDLE_MILLISECONDS = 10;
+
+  struct Node {
+    std::atomic<Node*> next;
+    Record record;
+  };
+
+  const std::function<void(const Record&)> write;
+  const std::function<void()> flush;
+  // The node before the first record, whose own record has been written (or is unused).
+  Node stub{{nullptr}, Record{}};
+  // The last pushed node.
+  std::atomic<Node*> head;
+  // The node before the next record to write. Only used by the logger thread.
+  Node* tail;
+  std::atomic<bool> stopping{false};
+  std::thread logger_thread;
+
+  // Writes the queued records. Returns false if there are none.
+  bool drain() {
+    bool written = false;
+    for (Node* next; (next = tail->next.load(std::memory_order_acquire)) != nullptr;) {
+      write(next->record);
+      if (tail != &stub) delete tail;
+      tail = next;
+      written = true;
+    }
+    if (written) flush();
+    return written;
+  }
+
+  void run() {
+    while (true) {
+      // The records pushed before the destructor are visible once `stopping` is.
+      const bool last = stopping.load(std::memory_order_acquire);
+      if (!drain()) {
+        if (last) break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(IDLE_MILLISECONDS));
+      }
+    }
+    if (tail != &stub) delete tail;
+  }
+};
@@ -0,0 +1,246 @@
+#include "coordinator.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+// Fills the socket address of the given address, see `Coordinator`. Returns false if the address
+// is invalid.
+bool parse_address(const std::string& address, sockaddr_storage& storage, socklen_t& length) {
+  storage = sockaddr_storage{};
+  if (address.find('/') != std::string::npos) {
+    sockaddr_un& un = reinterpret_cast<sockaddr_un&>(storage);
+    if (address.size() >= sizeof(un.sun_path)) return false;
+    un.sun_family = AF_UNIX;
+    std::copy(address.begin(), address.end(), un.sun_path);
+    length = sizeof(sockaddr_un);
+    return true;
+  }
+  const size_t colon = address.rfind(':');
+  const std::string host = colon == std::string::npos ? "127.0.0.1" : address.substr(0, colon);
+  const std::string port = colon == std::string::npos ? address : address.substr(colon + 1);
+  sockaddr_in& in = reinterpret_cast<sockaddr_in&>(storage);
+  in.sin_family = AF_INET;
+  const int port_number = atoi(port.c_str());
+  // Port 0 lets the system choose a free port, see `Coordinator::get_port()`.
+  if ((port_number <= 0 && port != "0") || port_number > 65535 ||
+      inet_pton(AF_INET, host.c_str(), &in.sin_addr) != 1) {
+    return false;
+  }
+  in.sin_port = htons(port_number);
+  length = sizeof(sockaddr_in);
+  return true;
+}
+
+// Sends the line with a newline. Returns false if the connection is closed.
+bool send_line(int fd, const std::string& line) {
+  const std::string text = line + "\n";
+  for (size_t sent = 0; sent < text.size();) {
+    const ssize_t n = send(fd, text.data() + sent, text.size() - sent, MSG_NOSIGNAL);
+    if (n <= 0) return false;
+    sent += n;
+  }
+  return true;
+}
+
+}  // namespace
+
+Coordinator::~Coordinator() {
+  if (listen_fd >= 0) close(listen_fd);
+  if (!socket_path.empty()) unlink(socket_path.c_str());
+}
+
+bool Coordinator::listen(const std::string& address) {
+  sockaddr_storage storage;
+  socklen_t length;
+  if (!parse_address(address, storage, length)) return false;
+  listen_fd = socket(storage.ss_family, SOCK_STREAM, 0);
+  if (listen_fd < 0) return false;
+  if (storage.ss_family == AF_UNIX) {
+    // Remove the socket left by a previous coordinator.
+    unlink(address.c_str());
+    socket_path = address;
+  } else {
+    const int reuse = 1;
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+  }
+  return bind(listen_fd, reinterpret_cast<sockaddr*>(&storage), length) == 0 &&
+         ::listen(listen_fd, SOMAXCONN) == 0;
+}
+
+int Coordinator::get_port() const {
+  sockaddr_storage storage;
+  socklen_t length = sizeof(storage);
+  if (listen_fd < 0 ||
+      getsockname(listen_fd, reinterpret_cast<sockaddr*>(&storage), &length) != 0 ||
+      storage.ss_family != AF_INET) {
+    return 0;
+  }
+  return ntohs(reinterpret_cast<const sockaddr_in&>(storage).sin_port);
+}
+
+void Coordinator::serve(const std::string& search_key, int first_id, int last_id,
+                        const std::function<void(const Result&)>& on_result) {
+  std::deque<int> pending;
+  for (int id = first_id; id <= last_id; id++) pending.push_back(id);
+  std::vector<bool> received(std::max(last_id - first_id + 1, 0), false);
+  int remaining = static_cast<int>(received.size());
+  std::list<Connection> connections;
+  int next_worker_id = 0;
+
+  // Closes the connection, and hands out its ids again first.
+  auto drop = [&pending, &connections](std::list<Connection>::iterator it) {
+    close(it->fd);
+    if (it->accepted) {
+      std::cout << "Worker " << it->worker_id << " disconnected";
+      if (!it->ids.empty()) std::cout << ", handing out its " << it->ids.size() << " ids again";
+      std::cout << "\n";
+    }
+    pending.insert(pending.begin(), it->ids.begin(), it->ids.end());
+    return connections.erase(it);
+  };
+
+  // Handles a line from the connection. Returns false if the connection should be closed.
+  auto handle_line = [&](Connection& c, const std::string& line) {
+    std::istringstream fields(line);
+    std::string tag;
+    fields >> tag;
+    if (tag == "hello") {
+      std::string key;
+      std::getline(fields >> std::ws, key);
+      if (key != search_key) {
+        send_line(c.fd, "error the search doesn't match " + search_key);
+        return false;
+      }
+      c.accepted = true;
+      std::cout << "Worker " << c.worker_id << " connected\n";
+      return send_line(c.fd, "ok");
+    }
+    if (!c.accepted) return false;
+    if (tag == "next") {
+      if (pending.empty()) return send_line(c.fd, "wait");
+      const int id = pending.front();
+      pending.pop_front();
+      c.ids.insert(id);
+      return send_line(c.fd, "job " + std::to_string(id));
+    }
+    if (tag == "result") {
+      Result result;
+      int ratio_n, ratio_d;
+      std::string graph;
+      if (!(fields >> result.base_graph_id >> ratio_n >> ratio_d) || ratio_d <= 0 ||
+          !std::getline(fields >> std::ws, graph) ||
+          !Graph::parse_edges(graph, result.min_ratio_graph) ||
+          c.ids.erase(result.base_graph_id) == 0) {
+        return false;
+      }
+      result.min_ratio = Fraction(ratio_n, ratio_d);
+      result.worker_id = c.worker_id;
+      if (!received[result.base_graph_id - first_id]) {
+        received[result.base_graph_id - first_id] = true;
+        --remaining;
+        on_result(result);
+      }
+      return true;
+    }
+    return false;
+  };
+
+  std::vector<pollfd> fds;
+  while (remaining > 0) {
+    fds.assign(1, pollfd{listen_fd, POLLIN, 0});
+    for (const Connection& c : connections) fds.push_back(pollfd{c.fd, POLLIN, 0});
+    if (poll(fds.data(), fds.size(), -1) < 0) continue;
+
+    auto it = connections.begin();
+    for (size_t i = 1; i < fds.size(); i++) {
+      if (fds[i].revents == 0) {
+        ++it;
+        continue;
+      }
+      char data[4096];
+      const ssize_t n = read(it->fd, data, sizeof(data));
+      if (n <= 0) {
+        it = drop(it);
+        continue;
+      }
+      it->buffer.append(data, n);
+      bool keep = true;
+      size_t newline;
+      while (keep && remaining > 0 && (newline = it->buffer.find('\n')) != std::string::npos) {
+        const std::string line = it->buffer.substr(0, newline);
+        it->buffer.erase(0, newline + 1);
+        keep = handle_line(*it, line);
+      }
+      it = keep ? std::next(it) : drop(it);
+    }
+
+    if ((fds[0].revents & POLLIN) != 0) {
+      const int fd = accept(listen_fd, nullptr, nullptr);
+      if (fd >= 0) {
+        Connection connection;
+        connection.fd = fd;
+        connection.worker_id = next_worker_id++;
+        connections.push_back(std::move(connection));
+      }
+    }
+  }
+  for (const Connection& c : connections) close(c.fd);
+}
+
+CoordinatorClient::~CoordinatorClient() {
+  if (fd >= 0) close(fd);
+}
+
+bool CoordinatorClient::connect(const std::string& address, const std::string& search_key) {
+  sockaddr_storage storage;
+  socklen_t length;
+  if (!parse_address(address, storage, length)) return false;
+  const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(CONNECT_TIMEOUT_SECONDS);
+  while (true) {
+    fd = socket(storage.ss_family, SOCK_STREAM, 0);
+    if (fd < 0) return false;
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&storage), length) == 0) break;
+    close(fd);
+    fd = -1;
+    if ((errno != ECONNREFUSED && errno != ENOENT) || std::chrono::steady_clock::now() > deadline) {
+      return false;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(CONNECT_RETRY_MILLISECONDS));
+  }
+  std::string line;
+  return send_line(fd, "hello " + search_key) && read_line(line) && line == "ok";
+}
+
+CoordinatorClient::Reply CoordinatorClient::request_job(int& base_graph_id) {
+  std::string line;
+  if (!send_line(fd, "next") || !read_line(line)) return Reply::DONE;
+  if (line == "wait") return Reply::WAIT;
+  return sscanf(line.c_str(), "job %d", &base_graph_id) == 1 ? Reply::JOB : Reply::DONE;
+}
+
+bool CoordinatorClient::send_result(int base_graph_id, Fraction min_ratio,
+                                    const Graph& min_ratio_graph) {
+  return send_line(fd, "result " + std::to_string(base_graph_id) + " " +
+                           std::to_string(min_ratio.n) + " " + std::to_string(min_ratio.d) +
+                           " " + min_ratio_graph.serialize_edges());
+}
+
+bool CoordinatorClient::read_line(std::string& line) {
+  size_t newline;
+  while ((newline = buffer.find('\n')) == std::string::npos) {
+    char data[4096];
+    const ssize_t n = read(fd, data, sizeof(data));
+    if (n <= 0) return false;
+    buffer.append(data, n);
+  }
+  line = buffer.substr(0, newline);
+  buffer.erase(0, newline + 1);
+  return true;
+}
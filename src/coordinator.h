@@ -0,0 +1,107 @@
+#pragma once
+
+#include "graph.h"
+
+// Distributes the base graphs of the final enumeration phase among worker processes on demand,
+// instead of splitting them by start_idx and end_idx by hand.
+//
+// The coordinator listens at an address, which is either the path of a UNIX socket (if it
+// contains '/'), or [HOST:]PORT of a TCP socket (HOST is 127.0.0.1 by default). The workers
+// connect to it, and talk in lines of text:
+//   worker:      hello <search key>
+//   coordinator: ok                   (or "error <reason>" and closes the connection)
+//   worker:      next
+//   coordinator: job <base_graph_id>  (or "wait" if all ids are handed out but some results
+//                                      are missing, in which case the worker asks again later)
+//   worker:      result <base_graph_id> <min_ratio.n> <min_ratio.d> <min_ratio_graph>
+// where the graph is in the form of Graph::serialize_edges(). The search key identifies the
+// search, so that workers of another search are rejected. A worker can ask for more ids before
+// sending the results of the previous ones. When a connection is closed, the ids handed out to
+// it without results are handed out again. When all results are received, the coordinator closes
+// all connections, which the workers take as the end of the work.
+class Coordinator {
+ public:
+  // The result of a base graph.
+  struct Result {
+    int base_graph_id;
+    Fraction min_ratio = Fraction::infinity();
+    Graph min_ratio_graph;
+    // The number of the worker connection that sent the result, starting from 0.
+    int worker_id;
+  };
+
+  Coordinator() = default;
+  Coordinator(const Coordinator&) = delete;
+  Coordinator& operator=(const Coordinator&) = delete;
+  ~Coordinator();
+
+  // Starts listening at the given address. Returns false on failure.
+  bool listen(const std::string& address);
+
+  // Returns the TCP port being listened at, which the system chooses if the address has port 0,
+  // or 0 for a UNIX socket.
+  int get_port() const;
+
+  // Hands out the ids between first_id and last_id (inclusive) to the workers with the given
+  // search key, and calls on_result() once for each id, until all results are received. Returns
+  // right away if last_id < first_id.
+  void serve(const std::string& search_key, int first_id, int last_id,
+             const std::function<void(const Result&)>& on_result);
+
+ private:
+  // A connected worker.
+  struct Connection {
+    int fd;
+    int worker_id;
+    // The received text after the last complete line.
+    std::string buffer;
+    // True after a matching hello.
+    bool accepted = false;
+    // The ids handed out to the worker without results.
+    std::set<int> ids;
+  };
+
+  int listen_fd = -1;
+  // The path of the UNIX socket, removed when done.
+  std::string socket_path;
+};
+
+// The connection of a worker process to the coordinator, see `Coordinator`.
+class CoordinatorClient {
+ public:
+  enum class Reply {
+    // A base graph id is given.
+    JOB,
+    // Ask again later.
+    WAIT,
+    // No more ids, or the connection is closed.
+    DONE,
+  };
+
+  CoordinatorClient() = default;
+  CoordinatorClient(const CoordinatorClient&) = delete;
+  CoordinatorClient& operator=(const CoordinatorClient&) = delete;
+  ~CoordinatorClient();
+
+  // Connects to the coordinator at the given address with the given search key, retrying for
+  // CONNECT_TIMEOUT_SECONDS seconds in case the coordinator is still growing the base graphs.
+  // Returns false if it can't connect or the coordinator rejects the search key.
+  bool connect(const std::string& address, const std::string& search_key);
+
+  // Asks for the next base graph id, which is stored in `base_graph_id`.
+  Reply request_job(int& base_graph_id);
+
+  // Sends the result of a base graph. Returns false if the connection is closed.
+  bool send_result(int base_graph_id, Fraction min_ratio, const Graph& min_ratio_graph);
+
+ private:
+  static constexpr int CONNECT_TIMEOUT_SECONDS = 600;
+  static constexpr int CONNECT_RETRY_MILLISECONDS = 100;
+
+  int fd = -1;
+  // The received text after the last complete line.
+  std::string buffer;
+
+  // Reads the next line without the newline. Returns false if the connection is closed.
+  bool read_line(std::string& line);
+};
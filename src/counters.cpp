@@ -6,20 +6,20 @@ constexpr int PRINT_EVERY_N_SECONDS = 100;
 
 Fraction Counters::min_ratio = Fraction::infinity();
 Graph Counters::min_ratio_graph{};
-uint64 Counters::compute_vertex_signatures = 0;
-std::atomic<uint64> Counters::graph_copies = 0;
-std::atomic<uint64> Counters::graph_contains_Tk_tests = 0;
+ShardedCounter Counters::compute_vertex_signatures;
+ShardedCounter Counters::graph_copies;
+ShardedCounter Counters::graph_contains_Tk_tests;
 uint64 Counters::growth_processed_graphs_in_current_step = 0;
 uint64 Counters::graph_accumulated_canonicals = 0;
-uint64 Counters::graph_canonicalize_ops = 0;
-uint64 Counters::graph_isomorphic_tests = 0;
-uint64 Counters::graph_isomorphic_true = 0;
-uint64 Counters::graph_isomorphic_expensive = 0;
-uint64 Counters::graph_isomorphic_hash_no = 0;
-uint64 Counters::graph_isomorphic_codeg_diff = 0;
-uint64 Counters::graph_identical_tests = 0;
-uint64 Counters::graph_permute_ops = 0;
-uint64 Counters::graph_permute_canonical_ops = 0;
+ShardedCounter Counters::graph_canonicalize_ops;
+ShardedCounter Counters::graph_isomorphic_tests;
+ShardedCounter Counters::graph_isomorphic_true;
+ShardedCounter Counters::graph_isomorphic_expensive;
+ShardedCounter Counters::graph_isomorphic_hash_no;
+ShardedCounter Counters::graph_isomorphic_codeg_diff;
+ShardedCounter Counters::graph_identical_tests;
+ShardedCounter Counters::graph_permute_ops;
+ShardedCounter Counters::graph_permute_canonical_ops;
 std::chrono::time_point<std::chrono::steady_clock> Counters::start_time;
 std::chrono::time_point<std::chrono::steady_clock> Counters::last_print_time;
 uint64 Counters::growth_vertex_count = 0;
@@ -37,6 +37,7 @@ bool Counters::in_final_step = false;
 std::ostream* Counters::log = nullptr;
 std::ostream* Counters::log_detail = nullptr;
 std::ostream* Counters::log_result = nullptr;
+std::ostream* Counters::log_perf = nullptr;
 
 // The version number that appears in the log file names and summary log.
 constexpr auto VERSION = "V12";
@@ -62,6 +63,8 @@ void Counters::initialize_logging(const std::string& prefix, int start_idx, int
   if (use_detail_log) {
     std::cout << log_file_name + "_detail.log, ";
     log_detail = new std::ofstream(log_file_name + "_detail.log");
+    std::cout << log_file_name + "_perf.jsonl, ";
+    log_perf = new std::ofstream(log_file_name + "_perf.jsonl");
   }
   std::cout << log_file_name + "_result.log\n";
   log_result = new std::ofstream(log_file_name + "_result.log");
@@ -85,10 +88,13 @@ void Counters::close_logging() {
   log_detail = nullptr;
   close_one(log_result);
   log_result = nullptr;
+  close_one(log_perf);
+  log_perf = nullptr;
 }
 
 void Counters::initialize() {
   min_ratio = Fraction::infinity();
+  min_ratio_graph = Graph();
   last_print_time = start_time = std::chrono::steady_clock::now();
 }
 
@@ -112,6 +118,22 @@ void Counters::observe_edgegen_stats(uint64 tk_skip, uint64 tk_skip_bits, uint64
   edgegen_edge_sets += edge_sets;
 }
 
+std::vector<uint64> Counters::get_final_step_stats() {
+  return {growth_accumulated_canonicals_in_current_step,
+          edgegen_tk_skip,
+          edgegen_tk_skip_bits,
+          edgegen_theta_edges_skip,
+          edgegen_theta_directed_edges_skip,
+          edgegen_edge_sets};
+}
+
+void Counters::restore_final_step_stats(const std::vector<uint64>& stats) {
+  assert(stats.size() == 6);
+  graph_accumulated_canonicals += stats[0];
+  growth_accumulated_canonicals_in_current_step += stats[0];
+  observe_edgegen_stats(stats[1], stats[2], stats[3], stats[4], stats[5]);
+}
+
 void Counters::new_growth_step(uint64 vertex_count, uint64 total_graphs_in_current_step) {
   growth_vertex_count = vertex_count;
   growth_total_graphs_in_current_step = total_graphs_in_current_step;
@@ -124,6 +146,7 @@ void Counters::enter_final_step(uint64 num_base_graphs) {
   min_ratio = Fraction::infinity();
   growth_num_base_graphs_in_final_step = num_base_graphs;
   growth_processed_graphs_in_current_step = 0;
+  growth_accumulated_canonicals_in_current_step = 0;
 }
 
 void Counters::initialize_ratio_graph_search(Fraction ratio_threshold) {
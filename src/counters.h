@@ -4,6 +4,35 @@
 #include "fraction.h"
 #include "graph.h"
 
+// A counter incremented from many threads, by the final enumeration phase and by the parallel
+// parts of the growth phase (see `GrowthSpill` and `Grower::grow_step_orderly()`). Each thread
+// increments one of SHARDS counters on its own cache line, so the threads don't bounce a shared
+// cache line between the cores (or the NUMA nodes) on every increment. Reading it sums the
+// shards.
+class ShardedCounter {
+ public:
+  void operator++() { shards[get_shard()].value.fetch_add(1, std::memory_order_relaxed); }
+  operator uint64() const {
+    uint64 sum = 0;
+    for (const Shard& shard : shards) sum += shard.value.load(std::memory_order_relaxed);
+    return sum;
+  }
+
+ private:
+  static constexpr int SHARDS = 64;
+  struct alignas(64) Shard {
+    std::atomic<uint64> value{0};
+  };
+  Shard shards[SHARDS];
+
+  // Returns the shard of the calling thread. The threads get the shards in turn.
+  static int get_shard() {
+    static std::atomic<int> next_shard{0};
+    thread_local const int shard = next_shard.fetch_add(1, std::memory_order_relaxed) % SHARDS;
+    return shard;
+  }
+};
+
 // Holds all statistical counters to keep track of number of operations during the search.
 class Counters {
  private:
@@ -19,25 +48,25 @@ class Counters {
   // True if we are already in the final step to enumerate graphs.
   static bool in_final_step;
 
-  static uint64 compute_vertex_signatures;
-  static std::atomic<uint64> graph_copies;
-  static std::atomic<uint64> graph_contains_Tk_tests;
+  static ShardedCounter compute_vertex_signatures;
+  static ShardedCounter graph_copies;
+  static ShardedCounter graph_contains_Tk_tests;
   static uint64 growth_processed_graphs_in_current_step;
   static uint64 graph_accumulated_canonicals;
-  static uint64 graph_canonicalize_ops;
-  static uint64 graph_isomorphic_tests;
+  static ShardedCounter graph_canonicalize_ops;
+  static ShardedCounter graph_isomorphic_tests;
   // Number of isomorphic tests that returned true.
-  static uint64 graph_isomorphic_true;
+  static ShardedCounter graph_isomorphic_true;
   // Number of isomorphic tests that have to use vertex permutations.
-  static uint64 graph_isomorphic_expensive;
+  static ShardedCounter graph_isomorphic_expensive;
   // Number of isomorphic tests that result in no, but had identical hash
-  static uint64 graph_isomorphic_hash_no;
+  static ShardedCounter graph_isomorphic_hash_no;
   // Among the cases where hash code match but the graphs are not isomorphic, the number of cases
   // where the codegree info are different.
-  static uint64 graph_isomorphic_codeg_diff;
-  static uint64 graph_identical_tests;
-  static uint64 graph_permute_ops;
-  static uint64 graph_permute_canonical_ops;
+  static ShardedCounter graph_isomorphic_codeg_diff;
+  static ShardedCounter graph_identical_tests;
+  static ShardedCounter graph_permute_ops;
+  static ShardedCounter graph_permute_canonical_ops;
   static uint64 growth_vertex_count;
   static uint64 growth_total_graphs_in_current_step;
   static uint64 growth_accumulated_canonicals_in_current_step;
@@ -62,6 +91,8 @@ class Counters {
   static std::ostream* log;
   static std::ostream* log_detail;
   static std::ostream* log_result;
+  // The perf log of the base graphs, only created with the detail log.
+  static std::ostream* log_perf;
 
   // Constructs the log file names using the given the parameters, and creates the log files.
   static void initialize_logging(const std::string& prefix, int start_idx, int end_idx, int threads,
@@ -110,6 +141,15 @@ class Counters {
   static void observe_edgegen_stats(uint64 tk_skip, uint64 tk_skip_bits, uint64 theta_edges_skip,
                                     uint64 theta_directed_edges_skip, uint64 edge_sets);
 
+  // Returns the counters of the final enumeration phase that are saved in the checkpoints: the
+  // number of graphs processed, followed by the edge gen stats in the order of
+  // observe_edgegen_stats().
+  static std::vector<uint64> get_final_step_stats();
+
+  // Adds the counters returned by get_final_step_stats() in a previous run, when resuming from
+  // a checkpoint.
+  static void restore_final_step_stats(const std::vector<uint64>& stats);
+
   // Print status if sufficient time has elapsed since the last print.
   static void print_at_time_interval();
 
@@ -0,0 +1,158 @@
+#include "cpu_topology.h"
+
+#include <pthread.h>
+#include <sched.h>
+
+namespace {
+
+// Parses a CPU list of sysfs such as "0-3,8-11". Returns an empty list if it's invalid.
+std::vector<int> parse_cpu_list(const std::string& text) {
+  std::vector<int> result;
+  std::istringstream in(text);
+  std::string range;
+  while (std::getline(in, range, ',')) {
+    int first, last;
+    const int count = sscanf(range.c_str(), "%d-%d", &first, &last);
+    if (count < 1) return {};
+    if (count == 1) last = first;
+    for (int cpu = first; cpu <= last; cpu++) result.push_back(cpu);
+  }
+  return result;
+}
+
+// Returns the CPU quota in CPUs from the cgroup v2 file cpu.max in the given directory, 0 if
+// it's unlimited, or -1 if there is no such file.
+double read_v2_quota(const std::string& dir) {
+  // "$MAX $PERIOD", where $MAX is "max" if unlimited.
+  std::ifstream in(dir + "/cpu.max");
+  std::string max;
+  double period;
+  if (!(in >> max >> period)) return -1;
+  return max == "max" || period <= 0 ? 0 : atof(max.c_str()) / period;
+}
+
+// The same as read_v2_quota(), from the cgroup v1 files of the cpu controller.
+double read_v1_quota(const std::string& dir) {
+  // The quota is -1 if unlimited.
+  std::ifstream quota_file(dir + "/cpu.cfs_quota_us");
+  std::ifstream period_file(dir + "/cpu.cfs_period_us");
+  double quota, period;
+  if (!(quota_file >> quota && period_file >> period)) return -1;
+  return quota > 0 && period > 0 ? quota / period : 0;
+}
+
+// Returns the smallest CPU quota read by `read_quota` in the directories of the cgroup at
+// `path` and of its ancestors under the mount point, since the quotas of the ancestors also
+// apply. The path may not exist under the mount point, such as in a container without a cgroup
+// namespace, in which case the root counts. Returns 0 if unlimited, or -1 if there is no file.
+double read_path_quota(const std::string& mount, std::string path,
+                       double (*read_quota)(const std::string&)) {
+  double result = -1;
+  while (true) {
+    if (!path.empty() && path.back() == '/') path.pop_back();
+    const double quota = read_quota(mount + path);
+    if (quota > 0 && (result <= 0 || quota < result)) {
+      result = quota;
+    } else if (quota == 0 && result < 0) {
+      result = 0;
+    }
+    if (path.empty()) return result;
+    const size_t slash = path.rfind('/');
+    path.erase(slash == std::string::npos ? 0 : slash);
+  }
+}
+
+// Returns the CPU quota in CPUs of the cgroup of the process, or 0 if there is none. The cgroup
+// is read from `proc_root`/self/cgroup: "0::$PATH" for cgroup v2, and "$ID:$CONTROLLERS:$PATH"
+// with the cpu controller for cgroup v1.
+double read_cpu_quota(const std::string& cgroup_root, const std::string& proc_root) {
+  std::string v2_path, v1_path;
+  std::ifstream in(proc_root + "/self/cgroup");
+  std::string line;
+  while (std::getline(in, line)) {
+    const size_t first = line.find(':');
+    const size_t second = first == std::string::npos ? first : line.find(':', first + 1);
+    if (second == std::string::npos) continue;
+    const std::string id = line.substr(0, first);
+    const std::string controllers = "," + line.substr(first + 1, second - first - 1) + ",";
+    if (id == "0" && controllers == ",,") {
+      v2_path = line.substr(second + 1);
+    } else if (controllers.find(",cpu,") != std::string::npos) {
+      v1_path = line.substr(second + 1);
+    }
+  }
+  // cgroup v2 takes precedence.
+  const double quota = read_path_quota(cgroup_root, v2_path, read_v2_quota);
+  if (quota >= 0) return quota;
+  return std::max(read_path_quota(cgroup_root + "/cpu", v1_path, read_v1_quota), 0.0);
+}
+
+}  // namespace
+
+CpuTopology CpuTopology::detect(const std::string& sysfs_root, const std::string& proc_root) {
+  std::vector<int> cpus;
+  cpu_set_t set;
+  if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+      if (CPU_ISSET(cpu, &set)) cpus.push_back(cpu);
+    }
+  }
+  if (cpus.empty()) {
+    for (int cpu = 0; cpu < static_cast<int>(std::thread::hardware_concurrency()); cpu++) {
+      cpus.push_back(cpu);
+    }
+  }
+
+  std::map<int, int> node_of_cpu;
+  for (int node = 0;; node++) {
+    std::ifstream in(sysfs_root + "/devices/system/node/node" + std::to_string(node) + "/cpulist");
+    std::string text;
+    if (!(in >> text)) break;
+    for (int cpu : parse_cpu_list(text)) node_of_cpu[cpu] = node;
+  }
+  std::vector<int> nodes;
+  for (int cpu : cpus) nodes.push_back(node_of_cpu.count(cpu) > 0 ? node_of_cpu[cpu] : 0);
+  return CpuTopology(cpus, nodes, read_cpu_quota(sysfs_root + "/fs/cgroup", proc_root));
+}
+
+CpuTopology::CpuTopology(std::vector<int> cpus_, std::vector<int> nodes_, double cpu_quota_)
+    : cpus(std::move(cpus_)), nodes(std::move(nodes_)), cpu_quota(cpu_quota_) {
+  // Number the nodes with allowed CPUs from 0.
+  std::map<int, int> node_index;
+  for (int node : nodes) node_index.emplace(node, 0);
+  node_count = 0;
+  for (auto& [node, index] : node_index) index = node_count++;
+  for (int& node : nodes) node = node_index[node];
+  node_count = std::max(node_count, 1);
+}
+
+int CpuTopology::get_available_cpu_count() const {
+  int count = std::max(static_cast<int>(cpus.size()), 1);
+  if (cpu_quota > 0) count = std::min(count, static_cast<int>(std::ceil(cpu_quota)));
+  return count;
+}
+
+int CpuTopology::get_worker_cpu(PlacementPolicy policy, int thread_id) const {
+  assert(policy != PlacementPolicy::NONE && !cpus.empty());
+  // The CPUs of each node in increasing order.
+  std::vector<std::vector<int>> node_cpus(node_count);
+  for (size_t i = 0; i < cpus.size(); i++) node_cpus[nodes[i]].push_back(cpus[i]);
+  std::vector<int> order;
+  if (policy == PlacementPolicy::COMPACT) {
+    for (const std::vector<int>& c : node_cpus) order.insert(order.end(), c.begin(), c.end());
+  } else {
+    for (size_t i = 0; order.size() < cpus.size(); i++) {
+      for (const std::vector<int>& c : node_cpus) {
+        if (i < c.size()) order.push_back(c[i]);
+      }
+    }
+  }
+  return order[thread_id % order.size()];
+}
+
+bool CpuTopology::pin_current_thread(int cpu) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <bits/stdc++.h>
+
+// How the worker threads of the final enumeration phase are placed on the CPUs.
+enum class PlacementPolicy {
+  // Leave the placement to the OS.
+  NONE,
+  // Pin the worker threads to the CPUs in order, filling a NUMA node before the next one, so
+  // that few threads share the Counters and the base graphs across nodes.
+  COMPACT,
+  // Pin the worker threads to the CPUs of the NUMA nodes in turn, so that each node gets its
+  // share of the memory bandwidth.
+  SCATTER,
+};
+
+// The CPUs this process may run on, and their NUMA nodes, as reported by Linux.
+class CpuTopology {
+ public:
+  // Reads the CPUs from the affinity mask of the process, their nodes from
+  // `sysfs_root`/devices/system/node, and the CPU quota from the cgroup files under
+  // `sysfs_root`/fs/cgroup (cgroup v2 cpu.max, or cgroup v1 cpu/cpu.cfs_quota_us) of the
+  // process's cgroup in `proc_root`/self/cgroup and its ancestors. Missing files are treated as
+  // a single node and no quota.
+  static CpuTopology detect(const std::string& sysfs_root = "/sys",
+                            const std::string& proc_root = "/proc");
+
+  // Constructs the topology with the given CPUs, the node of each CPU, and the CPU quota of the
+  // cgroup in CPUs (0 if none), for testing purpose.
+  CpuTopology(std::vector<int> cpus_, std::vector<int> nodes_, double cpu_quota_);
+
+  // Returns the number of CPUs the process can keep busy: the number of allowed CPUs, capped by
+  // the CPU quota rounded up.
+  int get_available_cpu_count() const;
+
+  // Returns the CPU to pin the given worker thread to under the given policy (not NONE). The
+  // CPUs are reused in the same order if there are more threads than CPUs.
+  int get_worker_cpu(PlacementPolicy policy, int thread_id) const;
+
+  // Returns the number of NUMA nodes with allowed CPUs.
+  int get_node_count() const { return node_count; }
+
+  // Pins the calling thread to the given CPU. Returns true if successful.
+  static bool pin_current_thread(int cpu);
+
+ private:
+  // The allowed CPUs in increasing order.
+  std::vector<int> cpus;
+  // The NUMA node of each CPU in `cpus`, numbering the nodes with allowed CPUs from 0.
+  std::vector<int> nodes;
+  // The CPU quota of the cgroup in CPUs, or 0 if there is none.
+  double cpu_quota;
+  int node_count;
+};
@@ -1,7 +1,6 @@
 #include "edge_gen.h"
 
 #include "counters.h"
-#include "forbid_tk/graph_tk.h"
 
 // Initializes the generator for the given new vertex count.
 // vertex_count = number of vertices to grow to in each new graph.
@@ -29,24 +28,331 @@ EdgeCandidates::EdgeCandidates(int vertex_count) : n(vertex_count), edge_candida
     }
     assert(vidx == Graph::K + 2);
   }
+
+  // Construct the T_k triples. For each edge candidate c and vertex w not in c, the other two
+  // edges are U-{a} and U-{b} where U = c+{w}, and a, b are in c but not (n-1).
+  const uint16 new_vertex_bit = 1 << (n - 1);
+  auto find_candidate = [this](uint16 vertex_set) {
+    return std::find(edge_candidates, edge_candidates + edge_candidate_count, vertex_set) -
+           edge_candidates;
+  };
+  for (int c = 0; c < edge_candidate_count; c++) {
+    const uint16 edge = edge_candidates[c];
+    for (int w = 0; w < n - 1; w++) {
+      if ((edge & (1 << w)) != 0) continue;
+      const uint16 u = edge | (1 << w);
+      for (uint16 ma = edge & ~new_vertex_bit; ma != 0; ma &= ma - 1) {
+        const int a = __builtin_ctz(ma);
+        for (uint16 mb = ma & (ma - 1); mb != 0; mb &= mb - 1) {
+          const int b = __builtin_ctz(mb);
+          const uint64 others = (1ULL << find_candidate(u & ~(1 << a))) |
+                                (1ULL << find_candidate(u & ~(1 << b)));
+          tk_triples[c].push_back({others, static_cast<uint16>((1 << w) | (1 << a) | (1 << b))});
+        }
+      }
+    }
+  }
+}
+
+// With CandidateOrder::ADAPTIVE, the low digits are reordered when a carry reaches at least
+// this digit.
+constexpr uint8 ADAPTIVE_ORDER_MIN_DIGITS = 6;
+
+EnumRange::EnumRange(uint32 begin_, uint32 end_)
+    : begin(begin_), packed((static_cast<uint64>(begin_) << 32) | end_) {
+  assert(begin_ < end_);
+}
+
+// Called by the thread running the enumeration when it reaches the given prefix. Returns true
+// if the prefix is still in the range. Returns false if the enumeration of this range is done.
+bool EnumRange::enter(uint32 prefix) {
+  uint64 old_value = packed.load();
+  while (true) {
+    uint32 end = static_cast<uint32>(old_value);
+    if (prefix >= end) return false;
+    uint64 new_value = (static_cast<uint64>(prefix) << 32) | end;
+    // On failure old_value is reloaded, which happens when an idle thread just stole part of the
+    // range, so we check against the new end again.
+    if (packed.compare_exchange_weak(old_value, new_value)) return true;
+  }
+}
+
+// Returns the number of prefixes in the range that are not yet entered.
+uint32 EnumRange::remaining() const {
+  uint64 value = packed.load();
+  uint32 current = static_cast<uint32>(value >> 32);
+  uint32 end = static_cast<uint32>(value);
+  return end > current + 1 ? end - current - 1 : 0;
+}
+
+// Called by an idle thread: removes the upper half (rounded up) of the prefixes that are not
+// yet entered from this range, and returns them in [stolen_begin, stolen_end).
+// Returns false if there is nothing left to steal.
+bool EnumRange::steal_half(uint32& stolen_begin, uint32& stolen_end) {
+  uint64 old_value = packed.load();
+  while (true) {
+    uint32 current = static_cast<uint32>(old_value >> 32);
+    uint32 end = static_cast<uint32>(old_value);
+    if (end <= current + 1) return false;
+    // The prefixes in (current, end) are not entered yet. Take the upper half of them.
+    uint32 mid = end - (end - current) / 2;
+    uint64 new_value = (static_cast<uint64>(current) << 32) | mid;
+    if (packed.compare_exchange_weak(old_value, new_value)) {
+      stolen_begin = mid;
+      stolen_end = end;
+      return true;
+    }
+  }
 }
 
 EdgeGenerator::EdgeGenerator(const EdgeCandidates& edge_candidates, const Graph& base_graph)
     : candidates(edge_candidates),
       base(base_graph),
+      adaptive_order(false),
+      range(nullptr),
+      prefix_low_digit(edge_candidates.edge_candidate_count),
+      batch_size(0),
+      batch_done(false),
+      batch_reordered(false),
+      reorder_count(0),
+      min_degree_filter(false),
+      edge_mask(0),
+      directed_mask(0),
+      changed_digits(0),
+      changed_edge(0),
+      tk_filter(false),
+      rest_info_valid(false),
+      ratio_bound(&Graph::get_theta_ratio_bound),
+      threshold_min_theta(0, 1),
       stats_tk_skip(0),
       stats_tk_skip_bits(0),
       stats_theta_edges_skip(0),
       stats_theta_directed_edges_skip(0),
-      stats_edge_sets(0) {
+      stats_edge_sets(0),
+      stats_forbidden_tests(0),
+      stats_enum_states(0) {
+  // The masks need one bit per edge candidate.
+  assert(candidates.edge_candidate_count < 64);
   for (uint8 i = 0; i < candidates.edge_candidate_count; i++) {
     enum_state[i] = 0;
+    order[i] = i;
+    skip_count[i] = 0;
   }
+  std::fill(edge_heads, edge_heads + (1 << MAX_VERTICES), NOT_IN_SET);
+  std::fill(directed_threshold, directed_threshold + MAX_EDGES + 1, -2);
+  std::fill(base_degree, base_degree + MAX_VERTICES, 0);
+  for (int i = 0; i < base.edge_count; i++) {
+    edge_heads[base.edges[i].vertex_set] = base.edges[i].head_vertex;
+    for (uint16 m = base.edges[i].vertex_set; m != 0; m &= m - 1) {
+      ++base_degree[__builtin_ctz(m)];
+    }
+  }
+  update_without_vertex_masks();
+
+  // The conflict tables are only used in the final step, see `contains_Tk_by_tables()`.
+  if (candidates.n != Graph::N) return;
+  const uint8 v = Graph::N - 1;
+  for (uint8 c = 0; c < candidates.edge_candidate_count; c++) {
+    std::fill(pair_conflicts[c], pair_conflicts[c] + Graph::K + 2, 0);
+    const uint16 edge = candidates.edge_candidates[c];
+    for (uint8 other = 0; other < candidates.edge_candidate_count; other++) {
+      const uint16 other_edge = candidates.edge_candidates[other];
+      if (__builtin_popcount(edge & other_edge) != Graph::K - 1) continue;
+      const uint16 u = edge | other_edge;
+      const uint8 base_head = edge_heads[u & ~(1 << v)];
+      if (base_head == NOT_IN_SET) continue;
+      // The base edge has its head in {x,y,z} iff the head is not in the intersection.
+      const bool base_head_in_triangle =
+          base_head != UNDIRECTED && ((edge & other_edge) >> base_head & 1) == 0;
+      for (uint8 value = 1; value <= Graph::K + 1; value++) {
+        // Edge c has its head in {x,y,z} iff the head is v or not in the other edge.
+        const uint8 head = candidates.edge_candidates_heads[c][value];
+        if (base_head_in_triangle ||
+            (head != UNDIRECTED && (head == v || (other_edge >> head & 1) == 0))) {
+          pair_conflicts[c][value] |= 1ULL << other;
+        }
+      }
+    }
+  }
+}
+
+void EdgeGenerator::set_min_degree_filter(bool enabled) {
+  assert(!enabled || candidates.n == Graph::N);
+  min_degree_filter = enabled;
+}
+
+void EdgeGenerator::update_without_vertex_masks() {
+  for (int w = 0; w < candidates.n - 1; w++) {
+    without_vertex_mask[w] = 0;
+    for (uint8 i = 0; i < candidates.edge_candidate_count; i++) {
+      if ((candidates.edge_candidates[order[i]] & (1 << w)) == 0) {
+        without_vertex_mask[w] |= 1ULL << i;
+      }
+    }
+  }
+}
+
+int EdgeGenerator::find_min_degree_violation() const {
+  int violation_digit = -1;
+  for (int w = 0; w < candidates.n - 1; w++) {
+    uint64 m = edge_mask & without_vertex_mask[w];
+    if (__builtin_popcountll(m) <= base_degree[w]) continue;
+    // The highest base_degree[w]+1 edges not containing w already violate the condition, so
+    // find the lowest digit among them.
+    for (int t = 0; t < base_degree[w]; t++) {
+      m &= ~(1ULL << (63 - __builtin_clzll(m)));
+    }
+    violation_digit = std::max(violation_digit, 63 - __builtin_clzll(m));
+  }
+  return violation_digit;
+}
+
+void EdgeGenerator::set_ratio_bound(RatioBoundFn bound) {
+  ratio_bound = bound;
+  std::fill(directed_threshold, directed_threshold + MAX_EDGES + 1, -2);
+}
+
+void EdgeGenerator::set_contains_forbidden(const std::function<bool(Graph&)>& contains) {
+  contains_forbidden = contains;
+}
+
+void EdgeGenerator::set_Tk_filter(bool enabled) {
+  assert(!enabled || candidates.n == Graph::N);
+  tk_filter = enabled;
+}
+
+// Sets the order of the edge candidates in the enumeration state.
+//
+// When notify_contain_tk_skip() finds T_k, it skips all edge sets that only differ from the
+// current one in the digits below the lowest edge in the set. So the skip is most effective when
+// the edge candidates likely to form T_k are at the higher digits. A new edge candidate c forms
+// T_k with two other edges in a (K+1)-set c+{w}. Since the base graph is T_k-free, one of them
+// must be new as well, unless the base graph has the edge (c-{n-1}+{w}). So we count such base
+// graph edges as how constrained the edge candidate is.
+void EdgeGenerator::set_candidate_order(CandidateOrder candidate_order) {
+  adaptive_order = candidate_order == CandidateOrder::ADAPTIVE;
+  if (candidate_order == CandidateOrder::ASCENDING) return;
+
+  int score[MAX_EDGES];
+  const uint16 new_vertex_mask = 1 << (candidates.n - 1);
+  for (uint8 c = 0; c < candidates.edge_candidate_count; c++) {
+    score[c] = 0;
+    const uint16 edge = candidates.edge_candidates[c];
+    for (int w = 0; w < candidates.n - 1; w++) {
+      if ((edge & (1 << w)) != 0) continue;
+      if (!base.edge_allowed((edge & ~new_vertex_mask) | (1 << w))) {
+        ++score[c];
+      }
+    }
+  }
+  // Keep the ascending order among the edge candidates with the same score.
+  std::stable_sort(order, order + candidates.edge_candidate_count,
+                   [&score](uint8 a, uint8 b) { return score[a] < score[b]; });
+  update_without_vertex_masks();
+}
+
+void EdgeGenerator::reorder_low_digits(uint8 digit_count) {
+  ++reorder_count;
+  std::stable_sort(order, order + digit_count,
+                   [this](uint8 a, uint8 b) { return skip_count[a] < skip_count[b]; });
+  update_without_vertex_masks();
+}
+
+void EdgeGenerator::set_digit(uint8 i, uint8 value) {
+  enum_state[i] = value;
+  edge_heads[candidates.edge_candidates[order[i]]] =
+      candidates.edge_candidates_heads[order[i]][value];
+  if (i > 0) rest_info_valid = false;
+  const uint64 bit = 1ULL << i;
+  changed_digits |= bit;
+  edge_mask = (edge_mask & ~bit) | (static_cast<uint64>(value != 0) << i);
+  directed_mask = (directed_mask & ~bit) | (static_cast<uint64>(value >= 2) << i);
+}
+
+void EdgeGenerator::set_digits(uint8 begin, uint8 end, uint8 value) {
+  if (begin >= end) return;
+  for (uint8 i = begin; i < end; i++) {
+    enum_state[i] = value;
+    edge_heads[candidates.edge_candidates[order[i]]] =
+        candidates.edge_candidates_heads[order[i]][value];
+  }
+  if (end > 1) rest_info_valid = false;
+  const uint64 bits = ((1ULL << end) - 1) & ~((1ULL << begin) - 1);
+  changed_digits |= bits;
+  edge_mask = value != 0 ? (edge_mask | bits) : (edge_mask & ~bits);
+  directed_mask = value >= 2 ? (directed_mask | bits) : (directed_mask & ~bits);
+}
+
+// Returns the number of distinct prefixes when the highest `prefix_digits` digits are used as
+// the prefix, namely (K+2)^prefix_digits.
+uint32 EdgeGenerator::get_prefix_count(int prefix_digits) {
+  uint32 count = 1;
+  for (int i = 0; i < prefix_digits; i++) {
+    count *= Graph::K + 2;
+  }
+  return count;
+}
+
+// Restricts the enumeration to the states whose prefixes (the highest `prefix_digits` digits
+// of the enumeration state) are in the given range. Must be called before the first next().
+void EdgeGenerator::restrict_to_range(int prefix_digits, EnumRange* enum_range) {
+  assert(0 <= prefix_digits && prefix_digits <= candidates.edge_candidate_count);
+  assert(enum_range->get_begin() < get_prefix_count(prefix_digits));
+  range = enum_range;
+  prefix_low_digit = candidates.edge_candidate_count - prefix_digits;
+
+  uint32 begin = enum_range->get_begin();
+  if (begin == 0) return;
+  // Set up the state such that the increment at the beginning of the first next() call lands
+  // on the first state with the `begin` prefix: the prefix digits hold (begin - 1), and all
+  // other digits hold the final value K+1. For example if the state has 6 digits, K=2, and the
+  // 2-digit prefix is 7 (written as "13" in base 4), then the state is initialized to
+  // [1,2,3,3,3,3], so the next() call advances it to [1,3,0,0,0,0].
+  uint32 value = begin - 1;
+  for (uint8 i = prefix_low_digit; i < candidates.edge_candidate_count; i++) {
+    set_digit(i, value % (Graph::K + 2));
+    value /= Graph::K + 2;
+  }
+  set_digits(0, prefix_low_digit, Graph::K + 1);
+}
+
+void EdgeGenerator::save_state(SavedState& state) const {
+  const uint8 count = candidates.edge_candidate_count;
+  state.enum_state.assign(enum_state, enum_state + count);
+  state.order.assign(order, order + count);
+  state.skip_count.assign(skip_count, skip_count + count);
+  state.done = batch_done;
+}
+
+void EdgeGenerator::restore_state(const SavedState& state) {
+  const uint8 count = candidates.edge_candidate_count;
+  assert(state.enum_state.size() == count && state.order.size() == count &&
+         state.skip_count.size() == count);
+  std::copy(state.order.begin(), state.order.end(), order);
+  std::copy(state.skip_count.begin(), state.skip_count.end(), skip_count);
+  update_without_vertex_masks();
+  for (uint8 i = 0; i < count; i++) {
+    set_digit(i, state.enum_state[i]);
+  }
+  rest_info_valid = false;
+  batch_done = state.done;
+  // The graph of the saved state isn't known to be free of the forbidden subgraph.
+  changed_digits = ~0ULL;
+}
+
+// Computes the prefix of the current enumeration state and tells the range that the
+// enumeration has reached it. Returns false if the prefix is beyond the range.
+bool EdgeGenerator::enter_current_prefix() {
+  uint32 prefix = 0;
+  for (int i = static_cast<int>(candidates.edge_candidate_count) - 1; i >= prefix_low_digit; i--) {
+    prefix = prefix * (Graph::K + 2) + enum_state[i];
+  }
+  return range->enter(prefix);
 }
 
 void EdgeGenerator::clear_stats() {
   stats_tk_skip = stats_tk_skip_bits = stats_theta_edges_skip = stats_theta_directed_edges_skip =
-      stats_edge_sets = 0;
+      stats_edge_sets = stats_forbidden_tests = stats_enum_states = 0;
 }
 
 // Generates the next edge set. Returns true enumeration should proceed,
@@ -73,44 +379,258 @@ bool EdgeGenerator::next(Graph& copy, bool use_known_min_theta_opt, Fraction kno
 
   while (true) {
     bool has_valid_candidate = false;
-    for (uint8 i = 0; i < candidates.edge_candidate_count; i++) {
-      ++enum_state[i];
-      if (enum_state[i] != Graph::K + 2) {
+    uint8 i = 0;
+    for (; i < candidates.edge_candidate_count; i++) {
+      const uint8 value = ++enum_state[i];
+      const uint8 c = order[i];
+      if (value != Graph::K + 2) {
         has_valid_candidate = true;
+        // The edge is now in the set, and it's directed unless it was just added as undirected.
+        edge_mask |= 1ULL << i;
+        directed_mask |= static_cast<uint64>(value >= 2) << i;
+        edge_heads[candidates.edge_candidates[c]] = candidates.edge_candidates_heads[c][value];
         break;
       }
       enum_state[i] = 0;
+      edge_heads[candidates.edge_candidates[c]] = NOT_IN_SET;
+    }
+    // All the digits below i wrapped around to 0.
+    changed_digits |= (2ULL << i) - 1;
+    edge_mask &= ~((1ULL << i) - 1);
+    directed_mask &= ~((1ULL << i) - 1);
+    if (i > 0) rest_info_valid = false;
+    // The digits below i are all 0, so they can be reordered. Only do it when the carry reaches
+    // far enough, so that the cost of reordering is negligible. The prefix digits are never
+    // reordered, since the ranges of the same base graph must agree on their meaning.
+    if (adaptive_order && i >= ADAPTIVE_ORDER_MIN_DIGITS) {
+      reorder_low_digits(std::min(i, prefix_low_digit));
     }
     // If we didn't find a valid candidate, the enumeration of all possible
     // edge combinations are done, we can return false.
     if (!has_valid_candidate) return false;
+    // If the increment reached the prefix digits, we may have left the range.
+    if (i >= prefix_low_digit && !enter_current_prefix()) return false;
+    ++stats_enum_states;
+
+    // With the min degree filter, skip all the states sharing the digits that violate it.
+    if (min_degree_filter) {
+      const int violation_digit = find_min_degree_violation();
+      if (violation_digit >= 0) {
+        set_digits(0, violation_digit, Graph::K + 1);
+        continue;
+      }
+    }
+
+    // If we are using min_theta optimization, perform it.
+    if (use_known_min_theta_opt) {
+      OptResult opt = perform_min_theta_optimization(known_min_theta);
+      if (opt == OptResult::DONE)
+        return false;
+      else if (opt == OptResult::CONTINUE_SEARCH)
+        continue;
+      // Otherwise passed the min_theta optimization check.
+    }
 
-    // If we are not using min_theta optimization, since we already have a candidate, break out
-    // of the while loop to return the current candidate.
-    if (!use_known_min_theta_opt) break;
+    // With the T_k filter, the states containing T_k are skipped here instead of being returned.
+    if (tk_filter && !passes_Tk_filter()) continue;
 
-    // Next we perform the min_theta optimization.
-    OptResult opt = perform_min_theta_optimization(known_min_theta);
-    if (opt == OptResult::FOUND_CANDIDATE)
-      break;  // Passed the min_theta optimization check, we have a winner.
-    else if (opt == OptResult::DONE)
-      return false;
-    else
-      continue;
+    // We have a winner, break out of the while loop to return the current candidate.
+    break;
   }
 
   // We found a new valid enumeration state. Generate a new graph into `copy`.
   generate_graph(copy, 0);
+  changed_edge = changed_digits == 1 ? candidates.edge_candidates[order[0]] : 0;
+  changed_digits = 0;
   ++stats_edge_sets;
   return true;
 }
+
+int EdgeGenerator::next_batch(Graph* graphs, int max_count, bool use_known_min_theta_opt,
+                              Fraction known_min_theta) {
+  assert(max_count <= EDGE_GEN_BATCH_SIZE);
+  batch_size = 0;
+  if (batch_done) return 0;
+  const uint8 count = candidates.edge_candidate_count;
+  std::copy(order, order + count, batch_order);
+  const uint32 reorder_count_before = reorder_count;
+  batch_reordered = false;
+  while (batch_size < max_count) {
+    if (!next(graphs[batch_size], use_known_min_theta_opt, known_min_theta)) {
+      batch_done = true;
+      break;
+    }
+    std::copy(enum_state, enum_state + count, batch_states[batch_size]);
+    batch_changed_edges[batch_size] = changed_edge;
+    ++batch_size;
+    if (reorder_count != reorder_count_before) {
+      batch_reordered = true;
+      break;
+    }
+  }
+  return batch_size;
+}
+
+void EdgeGenerator::rewind_batch(int index) {
+  assert(index < batch_size);
+  // Only the last state of the batch may use a different order than the others.
+  if (batch_reordered && index < batch_size - 1) {
+    std::copy(batch_order, batch_order + candidates.edge_candidate_count, order);
+    update_without_vertex_masks();
+  }
+  for (uint8 i = 0; i < candidates.edge_candidate_count; i++) {
+    set_digit(i, batch_states[index][i]);
+  }
+  batch_size = index + 1;
+  batch_done = false;
+  // The graph at `index` isn't known to be free of the forbidden subgraph.
+  changed_digits = ~0ULL;
+}
+
+bool EdgeGenerator::probe_search_tree(std::mt19937& rng, Fraction known_min_theta,
+                                      const std::function<bool(Graph&)>& contains_forbidden,
+                                      double& estimate, Graph& leaf) {
+  const int count = candidates.edge_candidate_count;
+  set_digits(0, count, 0);
+  estimate = 1;
+  double level_size = 1;
+  for (int d = count - 1; d >= 0; d--) {
+    uint8 children[MAX_VERTICES + 2];
+    int child_count = 0;
+    for (uint8 value = 0; value <= Graph::K + 1; value++) {
+      set_digit(d, value);
+      // The smallest possible ratio in the subtree is bounded with any of the d lower edges
+      // added, same as the check in perform_min_theta_optimization().
+      if (known_min_theta != Fraction::infinity()) {
+        const int directed = base.get_directed_edge_count() + __builtin_popcountll(directed_mask);
+        const int undirected = base.get_undirected_edge_count() +
+                               __builtin_popcountll(edge_mask & ~directed_mask);
+        if (known_min_theta <= ratio_bound(undirected, directed, d, d)) continue;
+      }
+      if (value != 0) {
+        if (min_degree_filter && find_min_degree_violation() >= 0) continue;
+        generate_graph(leaf, 0);
+        if (contains_forbidden(leaf)) continue;
+      }
+      children[child_count++] = value;
+    }
+    if (child_count == 0) return false;
+    level_size *= child_count;
+    estimate += level_size;
+    set_digit(d, children[std::uniform_int_distribution<int>(0, child_count - 1)(rng)]);
+  }
+  if (edge_mask == 0) return false;
+  generate_graph(leaf, 0);
+  return true;
+}
+
+// Computes whether the rest of the state (all digits except digit 0) contains T_k, and if not,
+// which values of digit 0 make T_k with the rest.
+//
+// Since the rest is T_k-free, a T_k must contain the edge of digit 0, namely e = U-{w} for some
+// (K+1)-set U. The other two edges are U-{a} and U-{b} for some a, b in e, with stem U-{w,a,b}.
+// So it's T_k iff one of the 3 edges is directed with its head in {w,a,b}. For U-{a} and U-{b},
+// this doesn't depend on digit 0, in which case any value other than NOT_IN_SET makes T_k.
+// Otherwise it's T_k iff e is directed with head a or b.
+void EdgeGenerator::compute_rest_info() {
+  rest_info_valid = true;
+  low_edge_always_Tk = false;
+  low_edge_Tk_heads = 0;
+
+  ++stats_forbidden_tests;
+  rest_contains_Tk = contains_Tk_by_tables(1);
+  if (rest_contains_Tk) return;
+
+  const uint16 low_edge = candidates.edge_candidates[order[0]];
+  for (int w = 0; w < Graph::N; w++) {
+    if ((low_edge & (1 << w)) != 0) continue;
+    const uint16 u = low_edge | (1 << w);
+    // Collect the vertices a in the low edge such that U-{a} is an edge, and its head.
+    int vertex_count = 0;
+    int vertices[MAX_VERTICES];
+    uint8 heads[MAX_VERTICES];
+    for (uint16 m = low_edge; m != 0; m &= m - 1) {
+      const int a = __builtin_ctz(m);
+      const uint8 head = edge_heads[u & ~(1 << a)];
+      if (head == NOT_IN_SET) continue;
+      for (int j = 0; j < vertex_count; j++) {
+        const int b = vertices[j];
+        // Note UNDIRECTED is beyond the bits of the mask, so it never matches.
+        const uint32 wab = (1 << w) | (1 << a) | (1 << b);
+        if (((wab >> head) & 1) != 0 || ((wab >> heads[j]) & 1) != 0) {
+          low_edge_always_Tk = true;
+          return;
+        }
+        low_edge_Tk_heads |= (1 << a) | (1 << b);
+      }
+      vertices[vertex_count] = a;
+      heads[vertex_count] = head;
+      ++vertex_count;
+    }
+  }
+}
+
+// Since the base graph is T_k-free, a T_k contains at least two new edges, which all contain
+// v = N-1. If v is in {x,y,z}, two of the edges are new and the third is a base edge, which is
+// looked up in pair_conflicts. Otherwise v is in the stem, and all three edges are new, which is
+// looked up in the T_k triples.
+bool EdgeGenerator::contains_Tk_by_tables(int skip_front) const {
+  const uint64 digits = edge_mask & ~((1ULL << skip_front) - 1);
+  uint64 present = 0;
+  for (uint64 m = digits; m != 0; m &= m - 1) {
+    present |= 1ULL << order[__builtin_ctzll(m)];
+  }
+  for (uint64 m = digits; m != 0; m &= m - 1) {
+    const uint8 i = __builtin_ctzll(m);
+    const uint8 c = order[i];
+    if ((pair_conflicts[c][enum_state[i]] & present) != 0) return true;
+    const uint8 head = candidates.edge_candidates_heads[c][enum_state[i]];
+    if (head == UNDIRECTED) continue;
+    for (const EdgeCandidates::TkTriple& triple : candidates.tk_triples[c]) {
+      if ((triple.triangle >> head & 1) != 0 && (present & triple.others) == triple.others) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+bool EdgeGenerator::passes_Tk_filter() {
+  if (!rest_info_valid) {
+    compute_rest_info();
+  }
+  if (rest_contains_Tk) {
+    // Same as if the caller found T_k in the current state.
+    notify_contain_tk_skip();
+    return false;
+  }
+  const uint8 value = enum_state[0];
+  if (value == 0) return true;
+  const uint8 head = candidates.edge_candidates_heads[order[0]][value];
+  if (low_edge_always_Tk || (head != UNDIRECTED && ((low_edge_Tk_heads >> head) & 1) != 0)) {
+    ++stats_tk_skip;
+    return false;
+  }
+  return true;
+}
+
+// Without the function, the forbidden subgraph is T_k, see `set_contains_forbidden()`.
+bool EdgeGenerator::contains_forbidden_by_front(int skip_front) const {
+  if (!contains_forbidden) return contains_Tk_by_tables(skip_front);
+  Graph copy;
+  generate_graph(copy, skip_front);
+  return contains_forbidden(copy);
+}
+
 void EdgeGenerator::generate_graph(Graph& copy, int skip_front) const {
   base.copy_edges(copy);
-  for (uint8 j = skip_front; j < candidates.edge_candidate_count; j++) {
-    if (enum_state[j] != 0) {
-      copy.add_edge(
-          Edge(candidates.edge_candidates[j], candidates.edge_candidates_heads[j][enum_state[j]]));
-    }
+  uint64 mask = edge_mask & ~((1ULL << skip_front) - 1);
+  while (mask != 0) {
+    const int j = __builtin_ctzll(mask);
+    mask &= mask - 1;
+    const uint8 c = order[j];
+    copy.add_edge(
+        Edge(candidates.edge_candidates[c], candidates.edge_candidates_heads[c][enum_state[j]]));
   }
 }
 
@@ -125,27 +645,47 @@ void EdgeGenerator::generate_graph(Graph& copy, int skip_front) const {
 // computationally feasible. This is very important when the base graph is very sparse
 // and therefore the new graphs are less likely to contain T_k, making the
 // `notify_contain_tk_skip` optimization less effective.
+// Returns the max number d of new directed edges such that the states with at most `new_edges`
+// new edges and at most d new directed edges can't have a smaller ratio than
+// threshold_min_theta. Since the bound doesn't increase with d, scan d downwards.
+int EdgeGenerator::get_directed_threshold(int new_edges) {
+  int& threshold = directed_threshold[new_edges];
+  if (threshold != -2) return threshold;
+  const int base_undirected = base.get_undirected_edge_count();
+  const int base_directed = base.get_directed_edge_count();
+  threshold = new_edges;
+  while (threshold >= 0 &&
+         threshold_min_theta >
+             ratio_bound(base_undirected, base_directed, new_edges, threshold)) {
+    --threshold;
+  }
+  return threshold;
+}
+
 EdgeGenerator::OptResult EdgeGenerator::perform_min_theta_optimization(Fraction known_min_theta) {
   // The number of new edges must satisfy the following inequality in order
   // for it to be interesting:
   //    base_undirected + known_min_theta * (base_directed + new_edges) > binom_nk
   // because otherwise, even if all new edges are directed, the theta produced would still
-  // be >= min_theta. Rewrite the inequility as
-  //    new_edges > (binom_nk - base_undirected) / known_min_theta - base_directed
-  // Thus
-  //    new_edges > floor((binom_nk - base_undirected) / known_min_theta) - base_directed
-  int new_edge_threshold = (Graph::TOTAL_EDGES - base.get_undirected_edge_count()) *
-                               known_min_theta.d / known_min_theta.n -
-                           base.get_directed_edge_count();
-  std::tuple<uint8, uint8, uint8, uint8> new_edge_info = count_edges();
-  uint8 new_edges = std::get<0>(new_edge_info);
-  uint8 new_directed_edges = std::get<1>(new_edge_info);
-  uint8 low_non_edge_idx = std::get<2>(new_edge_info);
-  uint8 low_non_directed_idx = std::get<3>(new_edge_info);
-
-  // First step: check number of new edges. Details of this inequality check are described above
-  // in the `new_edge_threshold` calculation.
-  if (new_edges <= new_edge_threshold) {
+  // be >= min_theta. In general, the states with at most new_edges new edges can be skipped if
+  // ratio_bound(base counts, new_edges, new_edges) >= known_min_theta, and the states with at
+  // most new_edges new edges, at most new_directed_edges of which are directed, can be skipped
+  // if ratio_bound(base counts, new_edges, new_directed_edges) >= known_min_theta. The max
+  // new_directed_edges for each new_edges is cached until known_min_theta changes.
+  if (known_min_theta != threshold_min_theta) {
+    threshold_min_theta = known_min_theta;
+    std::fill(directed_threshold, directed_threshold + candidates.edge_candidate_count + 1, -2);
+  }
+  // The bits above edge_candidate_count are always 0, so low_non_edge_idx and
+  // low_non_directed_idx are edge_candidate_count if all edges are in the set (and directed).
+  const uint8 new_edges = __builtin_popcountll(edge_mask);
+  const uint8 new_directed_edges = __builtin_popcountll(directed_mask);
+  const uint8 low_non_edge_idx = __builtin_ctzll(~edge_mask);
+  const uint8 low_non_directed_idx = __builtin_ctzll(~directed_mask);
+  const int threshold = get_directed_threshold(new_edges);
+
+  // First step: check number of new edges. Details of this inequality check are described above.
+  if (new_edges <= threshold) {
     ++stats_theta_edges_skip;
     // Here we can jump forward, to the state where it's ready to add another edge.
     // For example if the current enum state is [3, 0, 0, 1, 1, 1], and there are not
@@ -158,18 +698,16 @@ EdgeGenerator::OptResult EdgeGenerator::perform_min_theta_optimization(Fraction
       // return DONE to terminate the generation.
       return OptResult::DONE;
     }
-    for (uint8 i = 1; i <= low_non_edge_idx; i++) {
-      enum_state[i] = 1;
-    }
-    enum_state[0] = 0;
+    set_digits(1, low_non_edge_idx + 1, 1);
+    set_digit(0, 0);
+    // The jump may have moved the prefix forward, and out of the range.
+    if (low_non_edge_idx >= prefix_low_digit && !enter_current_prefix()) return OptResult::DONE;
     return OptResult::CONTINUE_SEARCH;
   }
   // If we get here, we have enough number of edges. But there still may not be enough number
-  // of directed edges. So just compute.
-  int total_directed = new_directed_edges + base.get_directed_edge_count();
-  int total_undirected = new_edges - new_directed_edges + base.get_undirected_edge_count();
-  if (total_directed == 0 ||
-      known_min_theta <= Fraction(Graph::TOTAL_EDGES - total_undirected, total_directed)) {
+  // of directed edges. For zeta_ratio, this never happens since the bound doesn't depend on the
+  // number of directed edges.
+  if (new_directed_edges <= threshold) {
     ++stats_theta_directed_edges_skip;
     // Here we can jump forward similar to above when we don't have enough total edges,
     // to the state where it's ready to add another directed edge.
@@ -178,15 +716,25 @@ EdgeGenerator::OptResult EdgeGenerator::perform_min_theta_optimization(Fraction
     // is NOT [3, 0, 1, 2, 2, 3] (the normal increment), but rather, [3, 0, 2, 2, 2, 2].
     // Since the begin of the for loop above does increment, we put the enum state to
     // [3, 0, 2, 2, 2, 1], to prepare for the for loop increment to do the job.
+    //
+    // However if the lowest non-directed edge is not in the set, for example the enum state is
+    // [3, 0, 0, 2, 2, 2], then adding it as an undirected edge increases the undirected edge
+    // count, which may produce a smaller theta. So the next enum state that may be interesting is
+    // [3, 0, 1, 0, 0, 0], and we put the enum state to [3, 0, 0, k+1, k+1, k+1] instead.
     if (low_non_directed_idx >= candidates.edge_candidate_count) {
       // In this case, all edges are present and directed and we still don't have enough directed
       // edges, simply return DONE to terminate the generation.
       return OptResult::DONE;
     }
-    for (uint8 i = 1; i <= low_non_directed_idx; i++) {
-      enum_state[i] = 2;
+    if (enum_state[low_non_directed_idx] == 0) {
+      set_digits(0, low_non_directed_idx, Graph::K + 1);
+    } else {
+      set_digits(1, low_non_directed_idx + 1, 2);
+      set_digit(0, 1);
+    }
+    if (low_non_directed_idx >= prefix_low_digit && !enter_current_prefix()) {
+      return OptResult::DONE;
     }
-    enum_state[0] = 1;
     return OptResult::CONTINUE_SEARCH;
   }
 
@@ -198,15 +746,20 @@ EdgeGenerator::OptResult EdgeGenerator::perform_min_theta_optimization(Fraction
 // makes it contain T_k, and therefore we can skip edge sets that are supersets of the current.
 void EdgeGenerator::notify_contain_tk_skip() {
   ++stats_tk_skip;
+  // The next graph can't be checked only for the changed edge, since the current graph isn't
+  // free of the forbidden subgraph.
+  changed_digits = ~0ULL;
   if (enum_state[0] == 0) {
     // Find the lowest non-zero enum state, and change everything below
     // it to the final state. Then the next() call will bump the lowest non-zero enum state.
     // For example, if the enum state is [3,0,0,1,0,0,0], update it to [3,0,0,1,k+1,k+1,k+1]
     // then the next call will get to [3,0,0,2,0,0,0].
-    for (uint8 i = 0; i < candidates.edge_candidate_count; i++) {
-      if (enum_state[i] != 0) return;
-      enum_state[i] = Graph::K + 1;
-      ++stats_tk_skip_bits;
+    const uint8 low_edge_idx = edge_mask == 0 ? candidates.edge_candidate_count
+                                              : __builtin_ctzll(edge_mask);
+    set_digits(0, low_edge_idx, Graph::K + 1);
+    stats_tk_skip_bits += low_edge_idx;
+    if (low_edge_idx < candidates.edge_candidate_count) {
+      ++skip_count[order[low_edge_idx]];
     }
   } else if (candidates.n == Graph::N) {
     // If we reach here, the lowest ranked edge is in the edge set. So there is no opportunity
@@ -234,44 +787,24 @@ void EdgeGenerator::notify_contain_tk_skip() {
     // after min_theta optimization was added, before adding this block of code, the code became
     // much faster for sparse base graphs, but also became much slower for dense base graphs.
     // This code block was added to specifically address the slow down.
-    Graph copy;
-    for (int skip_front = 1; skip_front < candidates.edge_candidate_count; skip_front++) {
-      generate_graph(copy, skip_front);
-      if (copy.get_edge_count() == base.get_edge_count()) return;
-      if (contains_Tk(copy, Graph::N - 1)) {
-        enum_state[skip_front - 1] = Graph::K + 1;
-        ++stats_tk_skip_bits;
-      }
-    }
-  }
-}
-
-// Returns a tuple:
-//    first = number of edges in the current state,
-//    second = number of directed edges in the current state,
-//    third = lowest index in enum_state where the edge is not in the set.
-//    forth = lowest index in enum_state where the edge is undirected or not in the set.
-std::tuple<uint8, uint8, uint8, uint8> EdgeGenerator::count_edges() const {
-  uint8 edges = 0;
-  uint8 directed = 0;
-  uint8 first_non_edge = candidates.edge_candidate_count;
-  uint8 first_non_directed_edge = candidates.edge_candidate_count;
-  for (int i = 0; i < candidates.edge_candidate_count; i++) {
-    if (enum_state[i] != 0) {
-      ++edges;
-      if (enum_state[i] != 1) {
-        ++directed;
+    //
+    // Since the graph without more edges is a subgraph, the skip_front values whose graphs
+    // contain the forbidden subgraph are 1, 2, ..., up to some value, which is found by binary
+    // search. The graph without all new edges is the base graph, which is free of it.
+    int low = 0;
+    int high = 64 - __builtin_clzll(edge_mask);
+    while (high - low > 1) {
+      const int skip_front = (low + high) / 2;
+      ++stats_forbidden_tests;
+      if (contains_forbidden_by_front(skip_front)) {
+        low = skip_front;
+      } else {
+        high = skip_front;
       }
-    } else if (first_non_edge == candidates.edge_candidate_count) {
-      first_non_edge = i;
-    }
-
-    if (first_non_directed_edge == candidates.edge_candidate_count &&
-        (enum_state[i] == 0 || enum_state[i] == 1)) {
-      first_non_directed_edge = i;
     }
+    set_digits(0, low, Graph::K + 1);
+    stats_tk_skip_bits += low;
   }
-  return std::make_tuple(edges, directed, first_non_edge, first_non_directed_edge);
 }
 
 void EdgeGenerator::print_debug(std::ostream& os, bool print_candidates, int base_graph_id) const {
@@ -282,7 +815,7 @@ void EdgeGenerator::print_debug(std::ostream& os, bool print_candidates, int bas
   if (print_candidates) {
     os << "\n      EC={";
     for (int e = static_cast<int>(candidates.edge_candidate_count) - 1; e >= 0; e--) {
-      os << std::bitset<MAX_VERTICES>(candidates.edge_candidates[e]);
+      os << std::bitset<MAX_VERTICES>(candidates.edge_candidates[order[e]]);
       if (e > 0) os << ", ";
     }
     os << "}";
@@ -3,6 +3,17 @@
 
 constexpr uint8 NOT_IN_SET = 0x0E;
 
+// The maximum number of graphs returned by one EdgeGenerator::next_batch() call.
+constexpr int EDGE_GEN_BATCH_SIZE = 64;
+
+// A function returning a lower bound of the ratio to minimize over the graphs with
+// (undirected + a) undirected edges and (directed + c) directed edges, for all a, c >= 0 such
+// that c <= max_new_directed and a + c <= max_new_edges. The bound must not increase with
+// max_new_edges or max_new_directed. Used by the min_theta optimization of EdgeGenerator, which
+// works for any ratio given its bound, e.g. `Graph::get_theta_ratio_bound()`.
+using RatioBoundFn = Fraction (*)(int undirected, int directed, int max_new_edges,
+                                  int max_new_directed);
+
 // This struct holds all edge candidates that contain vertex (n-1).
 struct EdgeCandidates {
   const uint16 n;                     // Number of vertices after adding the new vertex.
@@ -14,9 +25,70 @@ struct EdgeCandidates {
   // [2] to [k+1] are the vertices in the corresponding edge.
   uint8 edge_candidates_heads[MAX_EDGES][MAX_VERTICES + 2];
 
+  // Three edge candidates U-{x}, U-{y}, U-{z} for a (K+1)-set U, where (n-1) is in the stem
+  // U-{x,y,z}. They form T_k iff one of them is directed with its head in {x,y,z}.
+  struct TkTriple {
+    uint64 others;    // Bitmask of the indices of the other two edge candidates.
+    uint16 triangle;  // Bitmask of {x,y,z}.
+  };
+  // tk_triples[c] holds all triples containing edge candidate c. Only depends on K and n, and is
+  // empty when K = 2 since the stem can't contain (n-1).
+  std::vector<TkTriple> tk_triples[MAX_EDGES];
+
   explicit EdgeCandidates(int num_vertices);
 };
 
+// A range of enumeration state prefixes, used to split the enumeration of a single base graph
+// across several worker threads.
+//
+// The prefix of an enumeration state is the value of its highest `prefix_digits` digits (see
+// `EdgeGenerator::restrict_to_range()`), read as a base-(K+2) number. Since the enumeration visits
+// states in increasing prefix order, a prefix range [begin, end) is a contiguous segment of the
+// enumeration order.
+//
+// The range is shared between the thread running the EdgeGenerator, which moves `current` forward
+// as the enumeration proceeds, and idle threads which may steal the upper half of the prefixes
+// not yet entered, which moves `end` backward. Both values are packed into one atomic, so that
+// the two operations are linearizable and every prefix is enumerated by exactly one thread.
+class EnumRange {
+ private:
+  // The first prefix in this range. Never changes, used to order the results of the ranges.
+  const uint32 begin;
+  // (current << 32) | end, where `current` is the prefix being enumerated.
+  std::atomic<uint64> packed;
+
+ public:
+  EnumRange(uint32 begin_, uint32 end_);
+
+  uint32 get_begin() const { return begin; }
+
+  // Returns the prefix being enumerated, or `begin` if the enumeration hasn't started.
+  uint32 get_current() const { return static_cast<uint32>(packed.load() >> 32); }
+
+  // Called by the thread running the enumeration when it reaches the given prefix. Returns true
+  // if the prefix is still in the range. Returns false if the enumeration of this range is done.
+  bool enter(uint32 prefix);
+
+  // Returns the number of prefixes in the range that are not yet entered.
+  uint32 remaining() const;
+
+  // Called by an idle thread: removes the upper half (rounded up) of the prefixes that are not
+  // yet entered from this range, and returns them in [stolen_begin, stolen_end).
+  // Returns false if there is nothing left to steal.
+  bool steal_half(uint32& stolen_begin, uint32& stolen_end);
+};
+
+// The order of the edge candidates in the enumeration state of EdgeGenerator.
+enum class CandidateOrder {
+  // Digit i of the enumeration state is the i-th edge candidate (ascending bitmask).
+  ASCENDING = 0,
+  // The edge candidates that can form T_k with more base graph edges are put at higher digits.
+  CONSTRAINED = 1,
+  // Same as CONSTRAINED, but the lower digits are also reordered during the enumeration
+  // according to how often each edge candidate caused a T_k skip.
+  ADAPTIVE = 2,
+};
+
 // A helper class to generate all edge sets to add, when a new vertex is added to an existing graph.
 class EdgeGenerator {
  private:
@@ -27,12 +99,111 @@ class EdgeGenerator {
   // The values are indices into the edge_candidates_heads arrays.
   uint8 enum_state[MAX_EDGES];
 
-  // Returns a tuple:
-  //    first = number of edges in the current state,
-  //    second = number of directed edges in the current state,
-  //    third = lowest index in enum_state where the edge is not in the set.
-  //    forth = lowest index in enum_state where the edge is undirected or not in the set.
-  std::tuple<uint8, uint8, uint8, uint8> count_edges() const;
+  // order[i] is the index into the edge candidates for digit i of the enumeration state.
+  uint8 order[MAX_EDGES];
+  // If true, the low digits are reordered during the enumeration, see `reorder_low_digits()`.
+  bool adaptive_order;
+  // skip_count[c] is the number of times edge candidate c caused a T_k skip, namely it was the
+  // lowest edge in the set when notify_contain_tk_skip() skipped supersets of the edge set.
+  uint32 skip_count[MAX_EDGES];
+
+  // If not nullptr, the enumeration is restricted to the states whose prefixes are in this range.
+  EnumRange* range;
+  // The lowest digit of the prefix, i.e. enum_state[prefix_low_digit..edge_candidate_count-1]
+  // forms the prefix. Equals edge_candidate_count if there is no range restriction.
+  uint8 prefix_low_digit;
+
+  // Computes the prefix of the current enumeration state and tells the range that the
+  // enumeration has reached it. Returns false if the prefix is beyond the range.
+  bool enter_current_prefix();
+
+  // Reorders the digits 0..digit_count-1 whose values are all 0, so that the edge candidates
+  // causing more T_k skips are at higher digits, where their skips cover more edge sets.
+  // This doesn't change the set of edge sets enumerated, since the lower digits will go through
+  // all combinations before the next carry.
+  void reorder_low_digits(uint8 digit_count);
+
+  // The enumeration states of the graphs returned by the last next_batch() call, so that
+  // rewind_batch() can go back to any of them.
+  uint8 batch_states[EDGE_GEN_BATCH_SIZE][MAX_EDGES];
+  int batch_size;
+  // True if the enumeration is done, namely next() returned false during next_batch().
+  bool batch_done;
+  // The order at the beginning of the last batch. A batch ends right after a state where the low
+  // digits were reordered, so the states before it use this order.
+  uint8 batch_order[MAX_EDGES];
+  bool batch_reordered;
+  // Incremented by reorder_low_digits(), to detect the reordering in next_batch().
+  uint32 reorder_count;
+
+  // If true, only the states where the new vertex has the minimum degree are enumerated, see
+  // `set_min_degree_filter()`.
+  bool min_degree_filter;
+  // base_degree[w] is the number of edges containing vertex w in the base graph.
+  uint8 base_degree[MAX_VERTICES];
+  // Bit i of without_vertex_mask[w] is set iff the edge candidate of digit i doesn't contain
+  // vertex w. Updated whenever the order changes.
+  uint64 without_vertex_mask[MAX_VERTICES];
+  void update_without_vertex_masks();
+  // Returns the highest digit j such that the new edges of the digits >= j already make the new
+  // vertex's degree larger than another vertex's degree, or -1 if there is no such digit. Since
+  // it's true for all supersets of these edges, the states that only differ below digit j can
+  // all be skipped.
+  int find_min_degree_violation() const;
+
+  // Summary of the current enumeration state, maintained incrementally whenever enum_state
+  // changes, so that the min_theta optimization doesn't need to scan all the digits.
+  // Bit i of edge_mask is set iff enum_state[i] != 0, namely the edge is in the set.
+  // Bit i of directed_mask is set iff enum_state[i] >= 2, namely the edge is directed.
+  uint64 edge_mask;
+  uint64 directed_mask;
+
+  // Bitmask of the digits changed since the state last returned by next(), or all ones if that
+  // state contains the forbidden subgraph (see `notify_contain_tk_skip()`). The state before the
+  // first next() is the base graph, which is free of it.
+  uint64 changed_digits;
+  // See `get_changed_edge()`.
+  uint16 changed_edge;
+  // The changed edges of the graphs returned by the last next_batch() call.
+  uint16 batch_changed_edges[EDGE_GEN_BATCH_SIZE];
+
+  // Sets enum_state[i] to the given value, and updates the masks and edge_heads.
+  void set_digit(uint8 i, uint8 value);
+  // Sets enum_state[begin..end-1] to the given value, and updates the masks and edge_heads.
+  void set_digits(uint8 begin, uint8 end, uint8 value);
+
+  // If true, the states whose graphs contain T_k are filtered out in next(), see `set_Tk_filter`.
+  bool tk_filter;
+  // edge_heads[s] is the head of the edge with vertex set s in the graph of the current state,
+  // UNDIRECTED if the edge is undirected, or NOT_IN_SET if there is no such edge.
+  uint8 edge_heads[1 << MAX_VERTICES];
+  // Information about the graph without the edge of digit 0 (the "rest" of the state), which is
+  // used to evaluate all K+2 values of digit 0 at once. Computed by `compute_rest_info()`, and
+  // invalidated whenever any digit other than digit 0 changes.
+  bool rest_info_valid;
+  // True if the rest of the state already contains T_k.
+  bool rest_contains_Tk;
+  // True if adding the edge of digit 0 to the rest in any way (undirected or directed) makes T_k.
+  bool low_edge_always_Tk;
+  // Bitmask of the heads of the edge of digit 0 that make T_k with the rest of the state.
+  uint16 low_edge_Tk_heads;
+
+  // pair_conflicts[c][value] is the bitmask of the edge candidates c' such that edge candidate c
+  // with the given value, c' with any value, and an edge of the base graph form T_k with (n-1)
+  // in {x,y,z}. Namely c = U-{y}, c' = U-{z}, the base edge is U-{n-1}, and either the base edge
+  // or c has its head in {x,y,z}. (The case where c' has the head is in pair_conflicts[c'].)
+  // Only computed in the final step.
+  uint64 pair_conflicts[MAX_EDGES][MAX_VERTICES + 2];
+
+  // Returns true if the graph generated by `generate_graph(copy, skip_front)` contains T_k,
+  // using pair_conflicts and the T_k triples of the edge candidates, without generating it.
+  bool contains_Tk_by_tables(int skip_front) const;
+
+  // Computes the information about the rest of the state above.
+  void compute_rest_info();
+  // Returns true if the graph of the current state is T_k-free. Performs the T_k skips if it
+  // turns out the rest of the state contains T_k.
+  bool passes_Tk_filter();
 
   // Generates a new graph in `copy` by:
   //   (1) copies the base graph into `copy`,
@@ -52,9 +223,31 @@ class EdgeGenerator {
   // computationally feasible. This is very important when the base graph is very sparse
   // and therefore the new graphs are less likely to contain T_k, making the
   // `notify_contain_tk_skip` optimization less effective.
+  //
+  // The same works for any ratio with a bound function, see `set_ratio_bound()`.
   enum class OptResult { FOUND_CANDIDATE = 0, CONTINUE_SEARCH = 1, DONE = 2 };
   OptResult perform_min_theta_optimization(Fraction known_min_theta);
 
+  // The bound of the ratio used by the min_theta optimization and probe_search_tree().
+  RatioBoundFn ratio_bound;
+  // The known_min_theta of the last perform_min_theta_optimization() call.
+  Fraction threshold_min_theta;
+  // directed_threshold[e] is the max number d of new directed edges such that
+  // ratio_bound(base counts, e, d) >= threshold_min_theta, namely the states with at most e new
+  // edges and at most d new directed edges can be skipped, or -1 if there is no such d. -2 if
+  // not computed yet. Computed on demand, since the bound may be costly to compare.
+  int directed_threshold[MAX_EDGES + 1];
+  // Returns directed_threshold[new_edges], computing it if needed.
+  int get_directed_threshold(int new_edges);
+
+  // If not empty, returns true if the given graph contains the forbidden subgraph. Used by
+  // notify_contain_tk_skip() in the final step instead of the T_k tables, see
+  // `set_contains_forbidden()`.
+  std::function<bool(Graph&)> contains_forbidden;
+  // Returns true if the graph of the current state without the first `skip_front` edges contains
+  // the forbidden subgraph.
+  bool contains_forbidden_by_front(int skip_front) const;
+
  public:
   // Some performance counters used to monitor the edge gen behavior.
   uint64 stats_tk_skip;           // How many notify_contain_tk_skip().
@@ -62,6 +255,8 @@ class EdgeGenerator {
   uint64 stats_theta_edges_skip;  // How many skips due to min_theta opt, not enough edges.
   uint64 stats_theta_directed_edges_skip;  // How many skips due to min_theta opt, directed.
   uint64 stats_edge_sets;                  // How many edge sets returned from this generator.
+  uint64 stats_forbidden_tests;            // How many forbidden subgraph tests done.
+  uint64 stats_enum_states;                // How many enum states visited, skipped or not.
   void clear_stats();                      // Clear the above stats.
 
   // Initializes the generator for the given new vertex count.
@@ -86,10 +281,111 @@ class EdgeGenerator {
   bool next(Graph& copy, bool use_known_min_theta_opt = false,
             Fraction known_min_theta = Fraction(0, 1));
 
+  // Generates up to `max_count` next graphs into `graphs`, same as calling next() repeatedly with
+  // the same parameters, and returns how many graphs are generated. Returns 0 if all
+  // possibilities have already been enumerated.
+  //
+  // The caller processes the whole batch before the next call. When a graph in the batch turns
+  // out to contain a forbidden subgraph, the caller should call rewind_batch() with its index and
+  // then notify_contain_tk_skip(), and ignore the rest of the batch, which would have been skipped
+  // (or generated again) by the unbatched enumeration.
+  int next_batch(Graph* graphs, int max_count, bool use_known_min_theta_opt = false,
+                 Fraction known_min_theta = Fraction(0, 1));
+
+  // Rewinds the enumeration state to the graph at the given index in the last batch.
+  void rewind_batch(int index);
+
+  // Returns the vertex set of the only edge candidate whose digit changed between the previous
+  // graph returned by next() and the last one, or 0 if more digits changed or the previous graph
+  // contained the forbidden subgraph. The edge may be absent in the last graph. If not 0, the
+  // last graph without this edge is a subgraph of the previous graph (or the base graph), so the
+  // last graph contains the forbidden subgraph iff it contains one with this edge.
+  uint16 get_changed_edge() const { return changed_edge; }
+
+  // Returns the changed edges (see `get_changed_edge()`) of the graphs returned by the last
+  // next_batch() call. Only valid for the graphs up to the first one containing the forbidden
+  // subgraph.
+  const uint16* get_batch_changed_edges() const { return batch_changed_edges; }
+
   // Notify the generator about the fact that adding the current edge set to the graph
   // makes it contain T_k, and therefore we can skip edge sets that are supersets of the current.
+  // Only valid if every supergraph of a graph containing the forbidden subgraph contains it too.
   void notify_contain_tk_skip();
 
+  // Sets the bound of the ratio to minimize, used by the min_theta optimization and
+  // probe_search_tree(). By default it's `Graph::get_theta_ratio_bound()`.
+  void set_ratio_bound(RatioBoundFn bound);
+
+  // Sets the function returning true if the given graph contains the forbidden subgraph with
+  // vertex N-1, which notify_contain_tk_skip() calls in the final step to find more edge sets to
+  // skip. If not set, the forbidden subgraph is T_k, which is checked with bitmask tables.
+  void set_contains_forbidden(const std::function<bool(Graph&)>& contains);
+
+  // If enabled, next() only returns graphs that are T_k-free, so the caller doesn't need to
+  // check T_k (nor call notify_contain_tk_skip()). The T_k check of each state is done with
+  // bitmask operations by evaluating all values of digit 0 at once, given the rest of the state.
+  // Only used in the final enumeration phase for the T_k-free problem.
+  void set_Tk_filter(bool enabled);
+
+  // Runs one random probe of Knuth's tree size estimator through the search tree of the final
+  // enumeration, and stores the estimated number of nodes of the tree in `estimate`.
+  //
+  // The levels of the tree are the digits of the enumeration state from the highest to the
+  // lowest, and each node has one child for each value of its digit. A child is pruned when its
+  // graph (with the lower digits all 0) contains a forbidden subgraph, like the Contains T_k
+  // skip, or when even with all lower edges directed, its theta can't be smaller than
+  // `known_min_theta`, like the min_theta jumps. The probe picks a random unpruned child at each
+  // level, and the estimate is 1 + c1 + c1*c2 + ..., where ci is the number of unpruned children
+  // at level i. The average over many probes is an unbiased estimate of the tree size.
+  //
+  // Returns true if the probe reached the lowest level with at least one new edge, in which case
+  // `leaf` is the graph of the leaf. The enumeration state is changed, so the generator can't be
+  // used for next() afterwards.
+  bool probe_search_tree(std::mt19937& rng, Fraction known_min_theta,
+                         const std::function<bool(Graph&)>& contains_forbidden, double& estimate,
+                         Graph& leaf);
+
+  // If enabled, next() only returns the graphs where the new vertex N-1 has the minimum degree
+  // (the number of edges containing it), which are enough to find all graphs with N vertices up
+  // to isomorphism: any graph is an extension of the graph with a minimum degree vertex deleted.
+  // Since the degree of a base vertex w is its base degree plus the new edges containing w, the
+  // condition is that for every w, the number of new edges not containing w is at most the base
+  // degree of w. It's a hard cap, and the supersets of a state violating it are all skipped.
+  // Only used in the final enumeration phase.
+  void set_min_degree_filter(bool enabled);
+
+  // Sets the order of the edge candidates in the enumeration state. Must be called before the
+  // first next(). Note that a different order may find a different graph first among the graphs
+  // with the same ratio. Should only be used in the final enumeration phase.
+  void set_candidate_order(CandidateOrder candidate_order);
+
+  // Returns the number of distinct prefixes when the highest `prefix_digits` digits are used as
+  // the prefix, namely (K+2)^prefix_digits.
+  static uint32 get_prefix_count(int prefix_digits);
+
+  // Restricts the enumeration to the states whose prefixes (the highest `prefix_digits` digits
+  // of the enumeration state) are in the given range. Must be called before the first next().
+  // The range is not owned by this class, and must outlive it.
+  void restrict_to_range(int prefix_digits, EnumRange* enum_range);
+
+  // The position of the enumeration between two next_batch() calls, which is enough to continue
+  // the enumeration in another EdgeGenerator of the same base graph, e.g. after a restart.
+  struct SavedState {
+    std::vector<uint8> enum_state;
+    std::vector<uint8> order;
+    std::vector<uint32> skip_count;
+    // True if the enumeration is done.
+    bool done = false;
+  };
+
+  // Saves the position of the enumeration. Must be called between two next_batch() calls, after
+  // the batch is processed (including any rewind_batch() and notify_contain_tk_skip()).
+  void save_state(SavedState& state) const;
+
+  // Continues the enumeration from the saved position. Must be called after the options and
+  // restrict_to_range() (with the range entered up to the saved prefix), before the first next().
+  void restore_state(const SavedState& state);
+
   // Print the current state of this class to the given stream for debugging purpose.
   void print_debug(std::ostream& os, bool print_candidates, int base_graph_id) const;
 };
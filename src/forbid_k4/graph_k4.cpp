@@ -1,5 +1,17 @@
 #include "../graph.h"
 
+// Returns true if there is a K4 containing the triangle abc and a vertex in ds, where one of the
+// 6 edges is directed, given the neighbor bitsets s and ds is a set of common neighbors of a, b,
+// and c. Checks all vertices in ds at the same time.
+static bool contains_K4_with_triangle(const NeighborSets& s, int a, int b, int c, uint16 ds) {
+  const uint16 directed_a = s.out[a] | s.in[a];
+  const uint16 directed_b = s.out[b] | s.in[b];
+  const uint16 directed_c = s.out[c] | s.in[c];
+  // If one of ab, bc, ca is directed, any d works. Otherwise, one of da, db, dc is directed.
+  if ((directed_a & ((1 << b) | (1 << c))) != 0 || (directed_b & (1 << c)) != 0) return ds != 0;
+  return (ds & (directed_a | directed_b | directed_c)) != 0;
+}
+
 // Returns true if the given graph g contains F = {01, 02, 03, 12, 13, 23>3},
 // namely a complete graph with 4 vertices and at least one directed edge, and the given
 // vertex v is in F. Only works for 2-PDGs (K=3).
@@ -11,52 +23,42 @@
 bool contains_K4(const Graph& g, int v) {
   assert(Graph::K == 2);  // This logic only works for 2-PDG
 
-  int neighbor_count = 0;                 // The number of neighbors of vertex v.
-  int neighbors[MAX_VERTICES];            // The neighboring vertices of v.
-  bool neighbors_directed[MAX_VERTICES];  // Whether the neighbor is from a directed edge.
+  NeighborSets s;
+  g.get_neighbor_sets(s);
 
-  // First find all neighbors of v (ignore edge direction).
-  for (uint8 e = 0; e < g.edge_count; e++) {
-    if ((g.edges[e].vertex_set & (1 << v)) != 0) {
-      // The edge contains the given vertex v. Find the other vertex u.
-      int u = __builtin_ctz(static_cast<uint32>(g.edges[e].vertex_set & ~(1 << v)));
-      neighbors[neighbor_count] = u;
-      neighbors_directed[neighbor_count] = g.edges[e].head_vertex != UNDIRECTED;
-      ++neighbor_count;
+  // Find the triangles cde among the neighbors of v, for all d and e at once: c < d < e, d is a
+  // common neighbor of v and c, and e is a common neighbor of v, c and d.
+  const uint16 neighbors = s.all(v);
+  for (uint16 cs = neighbors; cs != 0; cs &= cs - 1) {
+    const int c = __builtin_ctz(cs);
+    const uint16 common_vc = neighbors & s.all(c) & ~((2 << c) - 1);
+    for (uint16 ds = common_vc; ds != 0; ds &= ds - 1) {
+      const int d = __builtin_ctz(ds);
+      const uint16 es = common_vc & s.all(d) & ~((2 << d) - 1);
+      if (contains_K4_with_triangle(s, v, c, d, es)) return true;
     }
   }
+  // If it gets here, we know the graph doesn't contain K4.
+  return false;
+}
 
-  // Next find the set of 3 neighbors, that are all linked by edges to each other:
-  // For all 0<= i<j<k < neighbor_count_of_v, if the 3 edges ij, jk, ki are all in the
-  // graph, and one of the 6 edges is directed, then the graph contains K4.
-  for (int i = 0; i < neighbor_count; i++) {
-    for (int j = i + 1; j < neighbor_count; j++) {
-      for (int k = j + 1; k < neighbor_count; k++) {
-        uint16 e_ij = (1 << neighbors[i]) | (1 << neighbors[j]);
-        uint16 e_jk = (1 << neighbors[j]) | (1 << neighbors[k]);
-        uint16 e_ki = (1 << neighbors[k]) | (1 << neighbors[i]);
-        bool has_ij = false, has_jk = false, has_ki = false;
-        bool directed_ij = false, directed_jk = false, directed_ki = false;
-        for (uint16 e = 0; e < g.edge_count; e++) {
-          if (g.edges[e].vertex_set == e_ij) {
-            has_ij = true;
-            directed_ij = g.edges[e].head_vertex != UNDIRECTED;
-          } else if (g.edges[e].vertex_set == e_jk) {
-            has_jk = true;
-            directed_jk = g.edges[e].head_vertex != UNDIRECTED;
-          } else if (g.edges[e].vertex_set == e_ki) {
-            has_ki = true;
-            directed_ki = g.edges[e].head_vertex != UNDIRECTED;
-          }
-        }
-        if (has_ij && has_jk && has_ki &&
-            (directed_ij || directed_jk || directed_ki || neighbors_directed[i] ||
-             neighbors_directed[j] || neighbors_directed[k])) {
-          return true;
-        }
-      }
-    }
+// Returns true if the given graph g contains F (see above), and the edge with the given vertex
+// set e is an edge of F. Returns false if there is no such edge in g. Only works for K=2.
+bool contains_K4_with_edge(const Graph& g, uint16 e) {
+  assert(Graph::K == 2);  // This logic only works for 2-PDG
+
+  NeighborSets s;
+  g.get_neighbor_sets(s);
+
+  // Let e = {a, b}. Then F = {a, b, c, d} where c and d are common neighbors of a and b, and cd
+  // is an edge.
+  const int a = __builtin_ctz(e);
+  const int b = __builtin_ctz(e & ~(1 << a));
+  if ((s.all(a) & (1 << b)) == 0) return false;
+  const uint16 common = s.all(a) & s.all(b);
+  for (uint16 cs = common; cs != 0; cs &= cs - 1) {
+    const int c = __builtin_ctz(cs);
+    if (contains_K4_with_triangle(s, a, b, c, common & s.all(c) & ~((2 << c) - 1))) return true;
   }
-  // If it gets here, we know the graph doesn't contain K4.
   return false;
 }
@@ -13,9 +13,20 @@
 // (3) changing directed edges to undirected by forgetting directions.
 bool contains_K4(const Graph& g, int v);
 
-// Derived class to manage the growth search, for K4-free problem.
-class GrowerK4 : public Grower {
-  using Grower::Grower;  // Inherite the constructor from the base class.
-  Fraction get_ratio(const Graph& g) const override { return g.get_theta_ratio(); }
-  bool contains_forbidden_subgraph(Graph& g, int v) const override { return contains_K4(g, v); }
-};
\ No newline at end of file
+// Returns true if the given graph g contains F (see above), and the edge with the given vertex
+// set e is an edge of F. Returns false if there is no such edge in g. Only works for K=2.
+bool contains_K4_with_edge(const Graph& g, uint16 e);
+
+// Grower policy of the K4-free problem, see `Grower`.
+struct K4Policy : GrowerPolicy {
+  std::string get_problem_name() const { return "k4"; }
+  Fraction get_ratio(const Graph& g) const { return g.get_theta_ratio(); }
+  RatioBoundFn get_ratio_bound() const { return &Graph::get_theta_ratio_bound; }
+  bool contains_forbidden_subgraph(Graph& g, int v) const { return contains_K4(g, v); }
+  bool contains_forbidden_subgraph_with_edge(Graph& g, uint16 edge) const {
+    return contains_K4_with_edge(g, edge);
+  }
+};
+
+// Manages the growth search, for K4-free problem.
+using GrowerK4 = Grower<K4Policy>;
\ No newline at end of file
@@ -1,5 +1,25 @@
 #include "graph_k4d0.h"
 
+// Returns true if the 4 vertices in `clique`, which are all connected by edges, contain F, given
+// the neighbor bitsets s.
+//
+// F can be obtained by orienting the undirected edges iff the directed edges have no cycle, since
+// then they can be extended into a transitive tournament. Equivalently, there is an apex which is
+// not the head of any of its edges, and the base is not a directed 3-cycle. So repeatedly remove
+// the vertices which are not the head of any edge among the remaining vertices.
+static bool complete_K4_contains_K4D0(const NeighborSets& s, uint16 clique) {
+  while (clique != 0) {
+    uint16 sources = 0;
+    for (uint16 bits = clique; bits != 0; bits &= bits - 1) {
+      const int u = __builtin_ctz(bits);
+      if ((s.in[u] & clique) == 0) sources |= 1 << u;
+    }
+    if (sources == 0) return false;
+    clique &= ~sources;
+  }
+  return true;
+}
+
 // Returns true if the given graph g contains the complete transitive K4,
 //   F={01>1, 02>2, 03>3, 12>2, 13>3, 23>3},
 // and the given vertex v is a vertex in F. Only works for 2-PDGs (K=2).
@@ -8,110 +28,51 @@
 // (1) deleting vertices
 // (2) deleting edges
 // (3) changing undirected edges to directed edges.
-bool contains_K4D0(Graph& g, int v) {
-  // Applicable to the entire implementation of this function:
-  //
-  // In F={01>1, 02>2, 03>3, 12>2, 13>3, 23>3}, we'll call 0 the apex, and 123 the base.
-  // Given v, if v is a vertex of F, and F is a subgrah of g, then either v is apex,
-  // or it's connected to the apex either via an undirected edge, or via a directed edge where
-  // the apex is the tail.
-
+bool contains_K4D0(const Graph& g, int v) {
   assert(Graph::K == 2);  // This logic only works for 2-PDG
 
-  // We need the degree info on all vertices that may be the apex.
-  // Note this mutates `g`, and is the only reason why we can't use a `const Graph&`.
-  g.compute_vertex_signature();
-
-  // The total degree must be at least 3
-  if (g.vertices[v].degree_undirected + g.vertices[v].degree_head + g.vertices[v].degree_tail < 3)
-    return false;
-
-  // Function that returns true if there is a subgraph F with the given apex in g.
-  //
-  // Aesthetic choice: we use a lambda here instead of declaring a separate function, to avoid
-  // adding another friend function to the Graph class.
-  auto contains_K4D0_apex = [g, v](int apex) {
-    // Basic qualification of being apex.
-    if (g.vertices[apex].degree_undirected + g.vertices[apex].degree_tail < 3) return false;
+  NeighborSets s;
+  g.get_neighbor_sets(s);
 
-    int neighbor_count = 0;       // The number of undirected or head neighbors of the apex.
-    int neighbors[MAX_VERTICES];  // The undirected or head neighboring vertices of apex.
+  // The total degree must be at least 3.
+  const uint16 neighbors = s.all(v);
+  if (__builtin_popcount(neighbors) < 3) return false;
 
-    // Find all undirected and head neighbors of apex.
-    for (int e = 0; e < g.edge_count; e++) {
-      if (g.edges[e].head_vertex != apex && (g.edges[e].vertex_set & (1 << apex)) != 0) {
-        // The edge contains the given vertex apex. Find the other vertex u.
-        int u = __builtin_ctz(static_cast<uint32>(g.edges[e].vertex_set & ~(1 << apex)));
-        neighbors[neighbor_count] = u;
-        ++neighbor_count;
+  // Check all K4 {v, c, d, e} with c < d < e: d is a common neighbor of v and c, and e is a
+  // common neighbor of v, c and d.
+  for (uint16 cs = neighbors; cs != 0; cs &= cs - 1) {
+    const int c = __builtin_ctz(cs);
+    const uint16 common_vc = neighbors & s.all(c) & ~((2 << c) - 1);
+    for (uint16 ds = common_vc; ds != 0; ds &= ds - 1) {
+      const int d = __builtin_ctz(ds);
+      for (uint16 es = common_vc & s.all(d) & ~((2 << d) - 1); es != 0; es &= es - 1) {
+        const uint16 clique = (1 << v) | (1 << c) | (1 << d) | (es & -es);
+        if (complete_K4_contains_K4D0(s, clique)) return true;
       }
     }
-    assert(neighbor_count >= 3);
-
-    // Loop through all sets of 3 undirected and head neighbors of apex, try to find a good base.
-    // The neighbor_mask is used as a bit mask representing indices in the neighbors array,
-    // e.g. 0b00001101 means the 0-th, 2nd, and 3rd elements in the neighbors array.
-    for (uint16 neighbor_mask = 0; neighbor_mask < (1 << neighbor_count); neighbor_mask++) {
-      // Ignore unless we have a 3-vertex set.
-      if (__builtin_popcount(neighbor_mask) != 3) continue;
-
-      // First transform the neighbor index mask into vertex mask.
-      // Example of vertex mask: 0b00001101 means vertices 0, 2, 3.
-      uint16 vertex_mask = 0;
-      uint32 nm = neighbor_mask;
-      for (int i = 0; i < 3; i++) {
-        int idx = __builtin_ctz(nm);
-        vertex_mask |= 1 << neighbors[idx];
-        nm &= ~(1 << idx);
-      }
-      assert(nm == 0);
-      assert(__builtin_popcount(vertex_mask) == 3);
-      // Ignore unless either the apex or the 3-vertex base contains v.
-      if (apex != v && (vertex_mask & (1 << v)) == 0) continue;
+  }
+  return false;
+}
 
-      // Find all edges in the base. Since there are only 3 vertices, there are <=3 edges.
-      int base_edge_indices[3]{0};
-      int base_edge_count = 0;
-      for (int e = 0; e < g.edge_count; e++) {
-        if (__builtin_popcount(g.edges[e].vertex_set & vertex_mask) == 2) {
-          base_edge_indices[base_edge_count++] = e;
-        }
-      }
-      // Ignore if there are less than 3 edges in the base.
-      if (base_edge_count < 3) continue;
+// Returns true if the given graph g contains F (see above), and the edge with the given vertex
+// set e is an edge of F. Returns false if there is no such edge in g. Only works for K=2.
+bool contains_K4D0_with_edge(const Graph& g, uint16 e) {
+  assert(Graph::K == 2);  // This logic only works for 2-PDG
 
-      // Check if the base contains a transitive triangle as a subgraph.
-      // Recall the subgraph definition in the summary comment of this function.
-      //
-      // If there is any undirected edge, we have a transitive base.
-      if (g.edges[base_edge_indices[0]].head_vertex == UNDIRECTED ||
-          g.edges[base_edge_indices[1]].head_vertex == UNDIRECTED ||
-          g.edges[base_edge_indices[2]].head_vertex == UNDIRECTED) {
-        return true;
-      }
-      // Now all 3 edges are directed, we have a transitive base as long as it's not a 3-cycle.
-      if (g.edges[base_edge_indices[0]].head_vertex == g.edges[base_edge_indices[1]].head_vertex ||
-          g.edges[base_edge_indices[1]].head_vertex == g.edges[base_edge_indices[2]].head_vertex ||
-          g.edges[base_edge_indices[0]].head_vertex == g.edges[base_edge_indices[2]].head_vertex) {
-        return true;
-      }
-    }
-    // All search done, we didn't find a F with the given apex.
-    return false;
-  };
+  NeighborSets s;
+  g.get_neighbor_sets(s);
 
-  // Back to the main body of the contains_K4D0 function. First check v as apex.
-  if (contains_K4D0_apex(v)) return true;
-  // Check all vertices u as apex, where u is connected to v by either an undirected edge,
-  // or a directed edge in which v is the head.
-  for (int e = 0; e < g.edge_count; e++) {
-    if ((g.edges[e].head_vertex == UNDIRECTED || g.edges[e].head_vertex == v) &&
-        (g.edges[e].vertex_set & (1 << v)) != 0) {
-      // The edge contains the given vertex apex. Find the other vertex u.
-      int u = __builtin_ctz(static_cast<uint32>(g.edges[e].vertex_set & ~(1 << v)));
-      if (contains_K4D0_apex(u)) return true;
+  // Let e = {a, b}. Then F = {a, b, c, d} where c and d are common neighbors of a and b, and cd
+  // is an edge.
+  const int a = __builtin_ctz(e);
+  const int b = __builtin_ctz(e & ~(1 << a));
+  if ((s.all(a) & (1 << b)) == 0) return false;
+  const uint16 common = s.all(a) & s.all(b);
+  for (uint16 cs = common; cs != 0; cs &= cs - 1) {
+    const int c = __builtin_ctz(cs);
+    for (uint16 ds = common & s.all(c) & ~((2 << c) - 1); ds != 0; ds &= ds - 1) {
+      if (complete_K4_contains_K4D0(s, e | (1 << c) | (ds & -ds))) return true;
     }
   }
-
   return false;
 }
@@ -11,11 +11,22 @@
 // (1) deleting vertices
 // (2) deleting edges
 // (3) changing undirected edges to directed edges.
-bool contains_K4D0(Graph& g, int v);
+bool contains_K4D0(const Graph& g, int v);
 
-// Derived class to manage the growth search, for K4D3-free problem.
-class GrowerK4D0 : public Grower {
-  using Grower::Grower;  // Inherite the constructor from the base class.
-  Fraction get_ratio(const Graph& g) const override { return g.get_zeta_ratio(); }
-  bool contains_forbidden_subgraph(Graph& g, int v) const override { return contains_K4D0(g, v); }
-};
\ No newline at end of file
+// Returns true if the given graph g contains F (see above), and the edge with the given vertex
+// set e is an edge of F. Returns false if there is no such edge in g. Only works for K=2.
+bool contains_K4D0_with_edge(const Graph& g, uint16 e);
+
+// Grower policy of the K4D0-free problem, see `Grower`.
+struct K4D0Policy : GrowerPolicy {
+  std::string get_problem_name() const { return "k4d0"; }
+  Fraction get_ratio(const Graph& g) const { return g.get_zeta_ratio(); }
+  RatioBoundFn get_ratio_bound() const { return &Graph::get_zeta_ratio_bound; }
+  bool contains_forbidden_subgraph(Graph& g, int v) const { return contains_K4D0(g, v); }
+  bool contains_forbidden_subgraph_with_edge(Graph& g, uint16 edge) const {
+    return contains_K4D0_with_edge(g, edge);
+  }
+};
+
+// Manages the growth search, for K4D0-free problem.
+using GrowerK4D0 = Grower<K4D0Policy>;
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "../graph_k4d0.h"
 
+#include "../../counters.h"
 #include "gtest/gtest.h"
 
 using namespace testing;
@@ -94,4 +95,60 @@ TEST(GraphK4D3Test, K5) {
     EXPECT_TRUE(contains_K4D0(g, v));
   }
   EXPECT_FALSE(contains_K4D0(g, 4));
-}
\ No newline at end of file
+}
+
+TEST(GraphK4D3Test, WithEdge) {
+  // contains_K4D0_with_edge() finds F through the edges of the new vertex iff contains_K4D0()
+  // does, and it only needs to check the changed edge reported by the edge generator.
+  Graph::set_global_graph_info(2, 6);
+  Graph base;
+  ASSERT_TRUE(Graph::parse_edges("{01, 02, 03, 12, 13>3, 24, 34>4}", base));
+  EdgeCandidates ec(6);
+  EdgeGenerator edge_gen(ec, base);
+  Graph copy;
+  int changed_count = 0;
+  while (edge_gen.next(copy)) {
+    const bool contains = contains_K4D0(copy, 5);
+    bool contains_with_edge = false;
+    for (int c = 0; c < ec.edge_candidate_count; c++) {
+      contains_with_edge |= contains_K4D0_with_edge(copy, ec.edge_candidates[c]);
+    }
+    EXPECT_EQ(contains_with_edge, contains);
+    const uint16 edge = edge_gen.get_changed_edge();
+    if (edge != 0) {
+      ++changed_count;
+      EXPECT_EQ(contains_K4D0_with_edge(copy, edge), contains);
+    }
+    if (contains) edge_gen.notify_contain_tk_skip();
+  }
+  EXPECT_GT(changed_count, 0);
+}
+
+// Checks every graph in the final enumeration phase on its own: the forbidden property is treated
+// as not monotone, and the ratio bound of 1 can't skip any graph with a smaller ratio.
+struct K4D0UnoptimizedPolicy : K4D0Policy {
+  RatioBoundFn get_ratio_bound() const {
+    return [](int, int, int, int) { return Fraction(1, 1); };
+  }
+  bool forbidden_is_monotone() const { return false; }
+};
+
+TEST(GraphK4D3Test, GrowerOptimizations) {
+  // The min_theta optimization with the zeta_ratio bound and the contains T_k optimization give
+  // the same result for each base graph as checking every graph.
+  for (int n = 4; n <= 6; n++) {
+    Graph::set_global_graph_info(2, n);
+    Counters::initialize();
+    Grower<K4D0UnoptimizedPolicy> expected(0, false, true, true, 0, 0);
+    expected.grow();
+    Counters::initialize();
+    GrowerK4D0 actual(0, false, true, true, 0, 0);
+    actual.grow();
+    const auto& a = expected.get_results();
+    const auto& b = actual.get_results();
+    ASSERT_EQ(a.size(), b.size());
+    for (size_t i = 0; i < a.size(); i++) {
+      EXPECT_EQ(std::get<2>(a[i]).serialize_edges(), std::get<2>(b[i]).serialize_edges());
+    }
+  }
+}
@@ -0,0 +1,266 @@
+#include "graph_pattern.h"
+
+bool ForbiddenPattern::compile(const std::string& edge_representation, SubgraphMode mode,
+                               ForbiddenPattern& result) {
+  Graph f;
+  if (!Graph::parse_edges(edge_representation, f) || f.edge_count == 0) return false;
+  uint16 vertex_set = 0;
+  for (int i = 0; i < f.edge_count; i++) vertex_set |= f.edges[i].vertex_set;
+  const int vertex_count = __builtin_popcount(vertex_set);
+  if (vertex_count > Graph::N) return false;
+  result.mode = mode;
+  result.vertex_set = vertex_set;
+
+  // The name is the FNV-1a hash of the sorted edges.
+  f.finalize_edges();
+  uint64 hash = 14695981039346656037ULL;
+  for (int i = 0; i < f.edge_count; i++) {
+    const uint16 s = f.edges[i].vertex_set;
+    for (uint8 byte : {s & 0xFF, s >> 8, int{f.edges[i].head_vertex}}) {
+      hash = (hash ^ byte) * 1099511628211ULL;
+    }
+  }
+  char hex[17];
+  snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(hash));
+  result.name =
+      std::string(mode == SubgraphMode::FORGET_DIRECTION ? "pattern_forget_" : "pattern_orient_") +
+      hex;
+
+  // The degrees of F. Under FORGET_DIRECTION, an undirected edge of F can be any edge of g, so
+  // it only counts in the total degree. Under ORIENT_UNDIRECTED, an undirected edge of F must be
+  // undirected in g, and a directed edge of F can also be undirected in g, so the degrees are
+  // the same as the ones of g.
+  std::fill(result.degrees, result.degrees + MAX_VERTICES, 0);
+  for (int i = 0; i < f.edge_count; i++) {
+    const Edge& e = f.edges[i];
+    for (uint16 bits = e.vertex_set; bits != 0; bits &= bits - 1) {
+      const int x = __builtin_ctz(bits);
+      if (e.head_vertex != UNDIRECTED) {
+        result.degrees[x] += DEGREE_TOTAL + (e.head_vertex == x ? DEGREE_HEAD : DEGREE_TAIL);
+      } else if (mode == SubgraphMode::ORIENT_UNDIRECTED) {
+        result.degrees[x] += DEGREE_TOTAL + DEGREE_UNDIRECTED + DEGREE_HEAD + DEGREE_TAIL;
+      } else {
+        result.degrees[x] += DEGREE_TOTAL;
+      }
+    }
+  }
+
+  // Returns true if mapping each vertex x to p[x] is an automorphism of F.
+  std::vector<uint8> heads(1 << MAX_VERTICES, 0);  // 1 + the head of each edge of F, or 0.
+  for (int i = 0; i < f.edge_count; i++) {
+    heads[f.edges[i].vertex_set] = f.edges[i].head_vertex + 1;
+  }
+  auto is_automorphism = [&f, &heads](const int p[]) {
+    for (int i = 0; i < f.edge_count; i++) {
+      uint16 s = 0;
+      for (uint16 bits = f.edges[i].vertex_set; bits != 0; bits &= bits - 1) {
+        s |= 1 << p[__builtin_ctz(bits)];
+      }
+      const uint8 head = f.edges[i].head_vertex;
+      if (heads[s] != (head == UNDIRECTED ? UNDIRECTED : p[head]) + 1) return false;
+    }
+    return true;
+  };
+
+  // Two vertices are twins if swapping them is an automorphism of F.
+  uint16 twins[MAX_VERTICES]{};
+  int p[MAX_VERTICES];
+  for (int x = 0; x < MAX_VERTICES; x++) p[x] = x;
+  for (uint16 xs = vertex_set; xs != 0; xs &= xs - 1) {
+    const int x = __builtin_ctz(xs);
+    for (uint16 ys = xs & (xs - 1); ys != 0; ys &= ys - 1) {
+      const int y = __builtin_ctz(ys);
+      std::swap(p[x], p[y]);
+      if (is_automorphism(p)) {
+        twins[x] |= 1 << y;
+        twins[y] |= 1 << x;
+      }
+      std::swap(p[x], p[y]);
+    }
+  }
+
+  // If an automorphism of F maps x to y, then v can be mapped to x iff it can be mapped to y, so
+  // only the smallest vertex in each orbit needs a plan. Find the automorphisms by bruteforce if
+  // F is small enough.
+  uint16 starts = vertex_set;
+  if (vertex_count <= 8) {
+    std::vector<int> vertices;
+    for (uint16 bits = vertex_set; bits != 0; bits &= bits - 1) {
+      vertices.push_back(__builtin_ctz(bits));
+    }
+    std::vector<int> permuted = vertices;
+    do {
+      for (int i = 0; i < vertex_count; i++) p[vertices[i]] = permuted[i];
+      if (!is_automorphism(p)) continue;
+      for (int x : vertices) {
+        if (p[x] < x) starts &= ~(1 << x);
+      }
+    } while (std::next_permutation(permuted.begin(), permuted.end()));
+  }
+
+  result.plans.clear();
+  for (uint16 bits = starts; bits != 0; bits &= bits - 1) {
+    result.plans.push_back(make_plan(f, __builtin_ctz(bits), twins));
+  }
+  return true;
+}
+
+std::vector<ForbiddenPattern::PlanStep> ForbiddenPattern::make_plan(const Graph& f, int start,
+                                                                     const uint16 twins[]) {
+  uint16 vertex_set = 0;
+  for (int i = 0; i < f.edge_count; i++) vertex_set |= f.edges[i].vertex_set;
+
+  std::vector<PlanStep> plan;
+  int positions[MAX_VERTICES];
+  uint16 placed = 0;
+  for (int x = start; x >= 0;) {
+    positions[x] = static_cast<int>(plan.size());
+    placed |= 1 << x;
+    PlanStep step{x, 0, -1, {}};
+    // The twins of the start vertex can't be ordered, since it's mapped to v.
+    if (x != start && (twins[x] & placed & ~(1 << start)) != 0) {
+      step.twin_position = positions[31 - __builtin_clz(twins[x] & placed & ~(1 << start))];
+    }
+    for (int i = 0; i < f.edge_count; i++) {
+      const Edge& e = f.edges[i];
+      if ((e.vertex_set & (1 << x)) == 0) continue;
+      for (uint16 bits = e.vertex_set & placed & ~(1 << x); bits != 0; bits &= bits - 1) {
+        step.neighbor_positions |= 1 << positions[__builtin_ctz(bits)];
+      }
+      if ((e.vertex_set & ~placed) != 0) continue;
+      PlanEdge plan_edge{0, UNDIRECTED};
+      for (uint16 bits = e.vertex_set & ~(1 << x); bits != 0; bits &= bits - 1) {
+        plan_edge.positions |= 1 << positions[__builtin_ctz(bits)];
+      }
+      if (e.head_vertex != UNDIRECTED) plan_edge.head = positions[e.head_vertex];
+      step.edges.push_back(plan_edge);
+    }
+    plan.push_back(step);
+
+    // The next vertex is the one closing the most edges, then the one sharing the most edges with
+    // the placed vertices, then the one with the highest degree, to prune the search early.
+    int next = -1;
+    std::tuple<int, int, int> best_score(-1, -1, -1);
+    for (uint16 bits = vertex_set & ~placed; bits != 0; bits &= bits - 1) {
+      const int y = __builtin_ctz(bits);
+      int closed = 0, shared = 0, degree = 0;
+      for (int i = 0; i < f.edge_count; i++) {
+        const uint16 s = f.edges[i].vertex_set;
+        if ((s & (1 << y)) == 0) continue;
+        ++degree;
+        if ((s & placed) != 0) ++shared;
+        if ((s & ~placed & ~(1 << y)) == 0) ++closed;
+      }
+      const std::tuple<int, int, int> score(closed, shared, degree);
+      if (score > best_score) {
+        best_score = score;
+        next = y;
+      }
+    }
+    x = next;
+  }
+  return plan;
+}
+
+bool ForbiddenPattern::contains(const Graph& g, int v) const {
+  // Same as in contains_Tk(), the tables are all 0 between the calls.
+  static thread_local uint8 edge_heads[compute_binom(MAX_VERTICES, MAX_VERTICES / 2)];
+  static thread_local uint16 completions[1 << MAX_VERTICES];
+  // For K=2, the completions are the same as the neighbors, which are already used as candidates.
+  const bool use_completions = Graph::K > 2;
+  SearchState state;
+  state.edge_heads = edge_heads;
+  state.completions = use_completions ? completions : nullptr;
+
+  // Collect the degrees and neighbors of the vertices of g.
+  const uint32 undirected_degree =
+      mode == SubgraphMode::ORIENT_UNDIRECTED
+          ? DEGREE_TOTAL + DEGREE_UNDIRECTED + DEGREE_HEAD + DEGREE_TAIL
+          : DEGREE_TOTAL + DEGREE_UNDIRECTED;
+  std::fill(state.neighbors, state.neighbors + Graph::N, 0);
+  std::fill(state.degrees, state.degrees + Graph::N, 0);
+  for (int i = 0; i < g.edge_count; i++) {
+    const Edge& e = g.edges[i];
+    edge_heads[Graph::EDGE_RANKS[e.vertex_set]] = e.head_vertex + 1;
+    const uint32 degree =
+        e.head_vertex == UNDIRECTED ? undirected_degree : DEGREE_TOTAL + DEGREE_TAIL;
+    for (uint16 bits = e.vertex_set; bits != 0; bits &= bits - 1) {
+      const int u = __builtin_ctz(bits);
+      state.neighbors[u] |= e.vertex_set;
+      state.degrees[u] += degree;
+      if (use_completions) completions[e.vertex_set & ~(1 << u)] |= 1 << u;
+    }
+    if (e.head_vertex != UNDIRECTED) state.degrees[e.head_vertex] += DEGREE_HEAD - DEGREE_TAIL;
+  }
+
+  // Try each plan with v as the image of its first vertex, which alone doesn't close any edge.
+  bool found = false;
+  for (const std::vector<PlanStep>& plan : plans) {
+    if (!degree_allowed(state.degrees[v], degrees[plan[0].vertex])) continue;
+    state.image[0] = v;
+    state.used = 1 << v;
+    if (search(plan, 1, state)) {
+      found = true;
+      break;
+    }
+  }
+
+  for (int i = 0; i < g.edge_count; i++) {
+    const uint16 s = g.edges[i].vertex_set;
+    edge_heads[Graph::EDGE_RANKS[s]] = 0;
+    if (!use_completions) continue;
+    for (uint16 bits = s; bits != 0; bits &= bits - 1) {
+      completions[s & ~(1 << __builtin_ctz(bits))] = 0;
+    }
+  }
+  return found;
+}
+
+bool ForbiddenPattern::search(const std::vector<PlanStep>& plan, int step,
+                              SearchState& state) const {
+  if (step == static_cast<int>(plan.size())) return true;
+  const PlanStep& s = plan[step];
+  uint16 candidates = ~state.used & ((1 << Graph::N) - 1);
+  for (uint16 bits = s.neighbor_positions; bits != 0; bits &= bits - 1) {
+    candidates &= state.neighbors[state.image[__builtin_ctz(bits)]];
+  }
+  if (s.twin_position >= 0) candidates &= ~((2 << state.image[s.twin_position]) - 1);
+
+  // The vertices of the edges closed by this step, except the image of this vertex.
+  uint16 edge_vertices[MAX_EDGES];
+  const int edge_count = static_cast<int>(s.edges.size());
+  for (int i = 0; i < edge_count; i++) {
+    edge_vertices[i] = 0;
+    for (uint16 bits = s.edges[i].positions; bits != 0; bits &= bits - 1) {
+      edge_vertices[i] |= 1 << state.image[__builtin_ctz(bits)];
+    }
+    if (state.completions != nullptr) candidates &= state.completions[edge_vertices[i]];
+  }
+
+  for (; candidates != 0; candidates &= candidates - 1) {
+    const int u = __builtin_ctz(candidates);
+    if (!degree_allowed(state.degrees[u], degrees[s.vertex])) continue;
+    state.image[step] = u;
+
+    // The edges closed by u are all in g, check their heads. Under FORGET_DIRECTION, the edge of
+    // g must have the same head as the edge of F unless the latter is undirected. Under
+    // ORIENT_UNDIRECTED, the edge of g must have the same head as the edge of F unless the former
+    // is undirected.
+    bool matched = true;
+    for (int i = 0; i < edge_count && matched; i++) {
+      if (mode == SubgraphMode::FORGET_DIRECTION && s.edges[i].head == UNDIRECTED) continue;
+      const uint8 head = s.edges[i].head == UNDIRECTED ? UNDIRECTED : state.image[s.edges[i].head];
+      const uint8 edge_head =
+          state.edge_heads[Graph::EDGE_RANKS[edge_vertices[i] | (1 << u)]] - 1;
+      matched = edge_head == head ||
+                (mode == SubgraphMode::ORIENT_UNDIRECTED && edge_head == UNDIRECTED);
+    }
+    if (!matched) continue;
+
+    state.used |= 1 << u;
+    const bool found = search(plan, step + 1, state);
+    state.used &= ~(1 << u);
+    if (found) return true;
+  }
+  return false;
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+#include "../graph.h"
+#include "../grower.h"
+
+// The subgraph definition used to match a forbidden graph F. In all cases, F is a subgraph of G
+// iff F can be obtained from G by (1) deleting vertices, (2) deleting edges, and (3) as follows.
+enum class SubgraphMode {
+  // (3) changing directed edges to undirected by forgetting directions. This is the definition
+  // of the T_k-free and K4-free problems.
+  FORGET_DIRECTION,
+  // (3) changing undirected edges to directed edges. This is the definition of the K4D0-free and
+  // K4D3-free problems.
+  ORIENT_UNDIRECTED,
+};
+
+// A forbidden graph F compiled into search plans, so that any F can be forbidden without writing
+// a contains_xyz() function for it.
+//
+// contains(g, v) maps the vertices of F to the vertices of g by backtracking. There is one plan
+// for each vertex x of F (up to the automorphisms of F) that v can be mapped to. The plan is the
+// order of the vertices of F to map, starting from x, such that each vertex closes as many edges
+// of F with the previous vertices as possible. The candidates of each vertex are the common
+// neighbors of its mapped neighbors in F which have enough degrees. If the vertex closes edges of
+// F, the candidates must also complete the other vertices of these edges into edges of g, which
+// are precomputed as bitmasks, and then the heads of the edges are checked. Twins in F (vertices
+// that can be swapped by an automorphism) other than x are mapped in increasing order to avoid
+// repeating the search.
+class ForbiddenPattern {
+ public:
+  // Compiles F given in the form of Graph::parse_edges(), e.g. "{01, 02, 03, 12, 13, 23>3}", with
+  // the given subgraph definition. Graph::set_global_graph_info() must be called first. F must
+  // have at least one edge and at most N vertices (vertex ids don't need to be consecutive).
+  // Returns true if successful.
+  static bool compile(const std::string& edge_representation, SubgraphMode mode,
+                      ForbiddenPattern& result);
+
+  // Returns true if g contains F as a subgraph, and v is a vertex of the subgraph.
+  bool contains(const Graph& g, int v) const;
+
+  // Returns the subgraph definition.
+  SubgraphMode get_mode() const { return mode; }
+  // Returns a name of F and the subgraph definition usable in file names, which is different for
+  // different edge representations of F with high probability.
+  const std::string& get_name() const { return name; }
+  // Returns the number of search plans, which is the number of orbits of the vertices of F under
+  // its automorphisms (or the number of vertices of F if it has more than 8 vertices).
+  int get_plan_count() const { return static_cast<int>(plans.size()); }
+
+ private:
+  // The degrees of a vertex are packed into 4 bytes: the number of edges, undirected edges,
+  // directed edges with the vertex as the head, and not as the head. Under ORIENT_UNDIRECTED, the
+  // last two also include the undirected edges. The vertex of g can be the image of a vertex of F
+  // only if each of its degrees is at least the one of the vertex of F.
+  static constexpr uint32 DEGREE_TOTAL = 0x00000001;
+  static constexpr uint32 DEGREE_UNDIRECTED = 0x00000100;
+  static constexpr uint32 DEGREE_HEAD = 0x00010000;
+  static constexpr uint32 DEGREE_TAIL = 0x01000000;
+
+  // An edge of F, with the vertices given by their positions in the plan.
+  struct PlanEdge {
+    // Bitmask of the positions of the vertices, except the last one.
+    uint16 positions;
+    // The position of the head, or UNDIRECTED.
+    uint8 head;
+  };
+
+  // The step of a plan that maps one vertex of F.
+  struct PlanStep {
+    // The vertex of F.
+    int vertex;
+    // Bitmask of the previous positions whose vertices share an edge with this vertex.
+    uint16 neighbor_positions;
+    // The position of the previous twin of this vertex, or -1. The image of this vertex must be
+    // larger than the image of the twin.
+    int twin_position;
+    // The edges of F whose last vertex in the plan is this vertex.
+    std::vector<PlanEdge> edges;
+  };
+
+  // The state of the search in contains().
+  struct SearchState {
+    // edge_heads[r] is 1 + the head of the edge with rank r in g, or 0 if there is no such edge.
+    const uint8* edge_heads;
+    // completions[s] is the bitmask of the vertices u such that s+{u} is an edge of g, for each
+    // set s of K-1 vertices. nullptr for K=2.
+    const uint16* completions;
+    // neighbors[u] is the bitmask of the vertices sharing an edge with u in g.
+    uint16 neighbors[MAX_VERTICES];
+    // The packed degrees of the vertices of g.
+    uint32 degrees[MAX_VERTICES];
+    // The vertex of g mapped from the vertex of F at each position of the plan.
+    int image[MAX_VERTICES];
+    // Bitmask of the vertices of g mapped so far.
+    uint16 used;
+  };
+
+  SubgraphMode mode;
+  // See get_name().
+  std::string name;
+  // Bitmask of the vertices of F.
+  uint16 vertex_set;
+  // The packed degrees of the vertices of F.
+  uint32 degrees[MAX_VERTICES];
+  // The search plans, one for each vertex that v can be mapped to.
+  std::vector<std::vector<PlanStep>> plans;
+
+  // Returns the search plan that starts from the given vertex of F, where twins[x] is the bitmask
+  // of the twins of x.
+  static std::vector<PlanStep> make_plan(const Graph& f, int start, const uint16 twins[]);
+
+  // Returns true if a vertex of g with the packed degrees `degree` can be the image of the vertex
+  // of F with the packed degrees `min_degree`. Each byte is compared without carries.
+  static bool degree_allowed(uint32 degree, uint32 min_degree) {
+    return (((degree | 0x80808080) - min_degree) & 0x80808080) == 0x80808080;
+  }
+
+  // Maps the vertices from the given step of the plan, given the mapping of the previous steps.
+  // Returns true if all vertices are mapped.
+  bool search(const std::vector<PlanStep>& plan, int step, SearchState& state) const;
+};
+
+// Grower policy of the F-free problem of the given ForbiddenPattern, see `Grower`. Minimizes
+// theta_ratio under FORGET_DIRECTION, and zeta_ratio under ORIENT_UNDIRECTED, same as the
+// hand-written problems.
+struct PatternPolicy : GrowerPolicy {
+  ForbiddenPattern pattern;
+
+  std::string get_problem_name() const { return pattern.get_name(); }
+  Fraction get_ratio(const Graph& g) const {
+    return pattern.get_mode() == SubgraphMode::FORGET_DIRECTION ? g.get_theta_ratio()
+                                                                 : g.get_zeta_ratio();
+  }
+  RatioBoundFn get_ratio_bound() const {
+    return pattern.get_mode() == SubgraphMode::FORGET_DIRECTION ? &Graph::get_theta_ratio_bound
+                                                                 : &Graph::get_zeta_ratio_bound;
+  }
+  bool contains_forbidden_subgraph(Graph& g, int v) const { return pattern.contains(g, v); }
+  bool contains_forbidden_subgraph_with_edge(Graph& g, uint16 edge) const {
+    return pattern.contains(g, 31 - __builtin_clz(edge));
+  }
+};
+
+// Manages the growth search, for the F-free problem of the given ForbiddenPattern.
+class GrowerPattern : public Grower<PatternPolicy> {
+ public:
+  template <typename... GrowerArgs>
+  GrowerPattern(const ForbiddenPattern& pattern, GrowerArgs... args)
+      : Grower(PatternPolicy{{}, pattern}, args...) {}
+};
@@ -0,0 +1,81 @@
+#include "../counters.h"
+#include "graph_pattern.h"
+
+void print_usage() {
+  std::cout << "Usage: kPDG-forbid-pattern [options] K N T F\n"
+            << "  K = Number of vertices in each edge.\n"
+            << "  N = Total number of vertices in a graph.  2 <= K <= N <= 12.\n"
+            << "  T = Number of worker threads. (0 means don't use threads,\n"
+            << "                                 -1 means no final phase).\n"
+            << "  F = The forbidden graph, in the edge representation such as\n"
+            << "    \"{01, 02, 03, 12, 13, 23>3}\", with K vertices in each edge and at most N\n"
+            << "    vertices.\n"
+            << "Options:\n"
+            << "  --subgraph=forget|orient : the subgraph definition (default forget). F is a\n"
+            << "    subgraph of G iff F can be obtained from G by deleting vertices, deleting\n"
+            << "    edges, and \"forget\": changing directed edges to undirected by forgetting\n"
+            << "    directions, or \"orient\": changing undirected edges to directed edges.\n"
+            << "    Minimizes theta for \"forget\", and zeta for \"orient\".\n";
+}
+
+int main(int argc, char* argv[]) {
+  // Options start with "--" and can appear anywhere, the rest are positional arguments.
+  std::vector<char*> args;
+  SubgraphMode mode = SubgraphMode::FORGET_DIRECTION;
+  for (int i = 0; i < argc; i++) {
+    if (i > 0 && strncmp(argv[i], "--", 2) == 0) {
+      if (strcmp(argv[i], "--subgraph=forget") == 0) {
+        mode = SubgraphMode::FORGET_DIRECTION;
+      } else if (strcmp(argv[i], "--subgraph=orient") == 0) {
+        mode = SubgraphMode::ORIENT_UNDIRECTED;
+      } else {
+        std::cout << "Unknown option " << argv[i] << ". See usage for details.\n";
+        print_usage();
+        return -1;
+      }
+    } else {
+      args.push_back(argv[i]);
+    }
+  }
+  if (args.size() != 5) {
+    print_usage();
+    return -1;
+  }
+  int k = atoi(args[1]);
+  int n = atoi(args[2]);
+  int t = atoi(args[3]);
+  bool skip_final_enum = false;
+  if (t < 0) {
+    skip_final_enum = true;
+    t = 0;
+  }
+
+  if (k < 2 || n > 12 || k > n || t < 0 || t > 128) {
+    std::cout << "Invalid command line arguments. See usage for details.\n";
+    print_usage();
+    return -1;
+  }
+  if (compute_binom(n, k) > MAX_EDGES) {
+    std::cout << "K=" << k << ", N=" << n
+              << " requires edge count more than MAX_EDGES=" << MAX_EDGES << ". Cannot execute.\n";
+    return -1;
+  }
+
+  Graph::set_global_graph_info(k, n);
+  ForbiddenPattern pattern;
+  if (!ForbiddenPattern::compile(args[4], mode, pattern)) {
+    std::cout << "Invalid forbidden graph " << args[4] << ". See usage for details.\n";
+    print_usage();
+    return -1;
+  }
+  Counters::initialize_logging("kPDG-forbid-pattern", 0, 0, t, false, Fraction(0, 1), false);
+  std::cout << "Forbidden graph " << args[4] << ", "
+            << (mode == SubgraphMode::FORGET_DIRECTION ? "forget" : "orient") << " subgraph, "
+            << pattern.get_plan_count() << " search plans\n";
+  GrowerPattern s(pattern, t, skip_final_enum, true, true, 0, 0);
+  s.set_logging(Counters::log, Counters::log_detail, Counters::log_result);
+  s.grow();
+  Counters::print_done_message();
+  Counters::close_logging();
+  return 0;
+}
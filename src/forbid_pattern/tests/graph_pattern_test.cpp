@@ -0,0 +1,153 @@
+#include "../graph_pattern.h"
+
+#include "../../counters.h"
+#include "../../forbid_k4/graph_k4.h"
+#include "../../forbid_k4d0/graph_k4d0.h"
+#include "../../forbid_k4d3/graph_k4d3.h"
+#include "../../forbid_tk/graph_tk.h"
+#include "gtest/gtest.h"
+
+using namespace testing;
+
+// Returns a random graph, where each edge is present with probability (8-density)/8, and then
+// directed with probability 1/2.
+Graph random_graph(std::mt19937& rng, int density) {
+  Graph g;
+  for (int r = 0; r < Graph::TOTAL_EDGES; r++) {
+    if (static_cast<int>(rng() % 8) < density) continue;
+    Edge e;
+    e.vertex_set = Graph::VERTEX_MASKS[Graph::K].masks[r];
+    e.head_vertex = UNDIRECTED;
+    if (rng() % 2 == 0) {
+      uint16 bits = e.vertex_set;
+      for (int skip = rng() % Graph::K; skip > 0; skip--) bits &= bits - 1;
+      e.head_vertex = __builtin_ctz(bits);
+    }
+    g.add_edge(e);
+  }
+  return g;
+}
+
+// Verifies that the pattern agrees with the hand-written contains(g, v) on random graphs.
+template <typename ContainsFn>
+void verify_random_graphs(const std::string& f, SubgraphMode mode, int k, int n,
+                          ContainsFn contains) {
+  Graph::set_global_graph_info(k, n);
+  ForbiddenPattern pattern;
+  ASSERT_TRUE(ForbiddenPattern::compile(f, mode, pattern));
+  std::mt19937 rng(0);
+  int contains_count = 0;
+  int total_count = 0;
+  for (int iter = 0; iter < 400; iter++) {
+    Graph g = random_graph(rng, 2 + iter % 4);
+    for (int v = 0; v < n; v++) {
+      const bool expected = contains(g, v);
+      EXPECT_EQ(pattern.contains(g, v), expected) << f << " " << g.serialize_edges() << " " << v;
+      contains_count += expected;
+      ++total_count;
+    }
+  }
+  EXPECT_GT(contains_count, 0);
+  EXPECT_LT(contains_count, total_count);
+}
+
+TEST(GraphPatternTest, Compile) {
+  Graph::set_global_graph_info(2, 4);
+  ForbiddenPattern pattern;
+  EXPECT_FALSE(ForbiddenPattern::compile("{}", SubgraphMode::FORGET_DIRECTION, pattern));
+  EXPECT_FALSE(ForbiddenPattern::compile("{012}", SubgraphMode::FORGET_DIRECTION, pattern));
+  EXPECT_FALSE(ForbiddenPattern::compile("{01, 23, 45}", SubgraphMode::FORGET_DIRECTION, pattern));
+  ASSERT_TRUE(ForbiddenPattern::compile("{01, 12, 23}", SubgraphMode::FORGET_DIRECTION, pattern));
+  EXPECT_EQ(pattern.get_plan_count(), 2);
+  ASSERT_TRUE(ForbiddenPattern::compile("{01, 02, 03, 12, 13, 23}",
+                                        SubgraphMode::FORGET_DIRECTION, pattern));
+  EXPECT_EQ(pattern.get_plan_count(), 1);
+  ASSERT_TRUE(ForbiddenPattern::compile("{01, 02, 03, 12, 13, 23>3}",
+                                        SubgraphMode::FORGET_DIRECTION, pattern));
+  EXPECT_EQ(pattern.get_plan_count(), 3);
+  ASSERT_TRUE(ForbiddenPattern::compile("{01>1, 02>2, 03>3, 12>2, 13>3, 23>3}",
+                                        SubgraphMode::ORIENT_UNDIRECTED, pattern));
+  EXPECT_EQ(pattern.get_plan_count(), 4);
+}
+
+TEST(GraphPatternTest, SubgraphMode) {
+  Graph::set_global_graph_info(2, 3);
+  Graph g;
+  ForbiddenPattern forget, orient;
+  ASSERT_TRUE(ForbiddenPattern::compile("{01, 12>2}", SubgraphMode::FORGET_DIRECTION, forget));
+  ASSERT_TRUE(ForbiddenPattern::compile("{01, 12>2}", SubgraphMode::ORIENT_UNDIRECTED, orient));
+
+  ASSERT_TRUE(Graph::parse_edges("{01>0, 12>2}", g));
+  EXPECT_TRUE(forget.contains(g, 0));
+  EXPECT_FALSE(orient.contains(g, 0));
+
+  ASSERT_TRUE(Graph::parse_edges("{01, 12}", g));
+  EXPECT_FALSE(forget.contains(g, 0));
+  EXPECT_TRUE(orient.contains(g, 0));
+
+  ASSERT_TRUE(Graph::parse_edges("{01, 12>2}", g));
+  EXPECT_TRUE(forget.contains(g, 2));
+  EXPECT_TRUE(orient.contains(g, 2));
+
+  ASSERT_TRUE(Graph::parse_edges("{01, 12>1}", g));
+  EXPECT_FALSE(forget.contains(g, 2));
+  EXPECT_FALSE(orient.contains(g, 2));
+
+  ASSERT_TRUE(Graph::parse_edges("{01>1, 12>1}", g));
+  EXPECT_FALSE(forget.contains(g, 2));
+  EXPECT_FALSE(orient.contains(g, 2));
+
+  // The vertex must be in the subgraph.
+  Graph::set_global_graph_info(2, 4);
+  ASSERT_TRUE(Graph::parse_edges("{01, 12>2, 13}", g));
+  EXPECT_TRUE(forget.contains(g, 2));
+  EXPECT_TRUE(forget.contains(g, 3));
+  ASSERT_TRUE(Graph::parse_edges("{01, 12>2, 03}", g));
+  EXPECT_TRUE(forget.contains(g, 0));
+  EXPECT_FALSE(forget.contains(g, 3));
+}
+
+TEST(GraphPatternTest, Tk) {
+  verify_random_graphs("{12, 13, 23>3}", SubgraphMode::FORGET_DIRECTION, 2, 6, contains_Tk);
+  verify_random_graphs("{124, 134, 234>3}", SubgraphMode::FORGET_DIRECTION, 3, 6, contains_Tk);
+  verify_random_graphs("{1245, 1345, 2345>3}", SubgraphMode::FORGET_DIRECTION, 4, 7,
+                       contains_Tk);
+}
+
+TEST(GraphPatternTest, K4) {
+  verify_random_graphs("{01, 02, 03, 12, 13, 23>3}", SubgraphMode::FORGET_DIRECTION, 2, 7,
+                       contains_K4);
+}
+
+TEST(GraphPatternTest, K4D0) {
+  verify_random_graphs("{01>1, 02>2, 03>3, 12>2, 13>3, 23>3}", SubgraphMode::ORIENT_UNDIRECTED,
+                       2, 7, contains_K4D0);
+}
+
+TEST(GraphPatternTest, K4D3) {
+  verify_random_graphs("{01, 02, 03, 12>2, 13>3, 23>3}", SubgraphMode::ORIENT_UNDIRECTED, 2, 7,
+                       contains_K4D3);
+}
+
+TEST(GraphPatternTest, Grower) {
+  // Growing with the pattern of T_k gives the same results as GrowerTk.
+  for (int n = 4; n <= 6; n++) {
+    Graph::set_global_graph_info(2, n);
+    ForbiddenPattern pattern;
+    ASSERT_TRUE(
+        ForbiddenPattern::compile("{12, 13, 23>3}", SubgraphMode::FORGET_DIRECTION, pattern));
+    Counters::initialize();
+    GrowerTk expected(0, false, false, false, 0, 0);
+    expected.grow();
+    Counters::initialize();
+    GrowerPattern actual(pattern, 0, false, false, false, 0, 0);
+    actual.grow();
+    const auto& a = expected.get_results();
+    const auto& b = actual.get_results();
+    ASSERT_EQ(a.size(), b.size());
+    for (size_t i = 0; i < a.size(); i++) {
+      EXPECT_EQ(std::get<1>(a[i]).serialize_edges(), std::get<1>(b[i]).serialize_edges());
+      EXPECT_EQ(std::get<2>(a[i]).serialize_edges(), std::get<2>(b[i]).serialize_edges());
+    }
+  }
+}
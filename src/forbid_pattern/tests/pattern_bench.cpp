@@ -0,0 +1,88 @@
+// A benchmark comparing ForbiddenPattern::contains() with the hand-written contains_xyz()
+// functions of the T_k-free, K4-free, K4D0-free and K4D3-free problems.
+//
+// Both are run on the same random graphs for all vertices. The results must match, and the
+// average time per call of each is printed.
+
+#include "../../forbid_k4/graph_k4.h"
+#include "../../forbid_k4d0/graph_k4d0.h"
+#include "../../forbid_k4d3/graph_k4d3.h"
+#include "../../forbid_tk/graph_tk.h"
+#include "../graph_pattern.h"
+
+// Returns random graphs, where each edge is present with probability between 1/4 and 5/8, and
+// then directed with probability 1/2.
+std::vector<Graph> random_graphs(int count) {
+  std::mt19937 rng(0);
+  std::vector<Graph> graphs(count);
+  for (int i = 0; i < count; i++) {
+    for (int r = 0; r < Graph::TOTAL_EDGES; r++) {
+      if (static_cast<int>(rng() % 8) < 3 + i % 4) continue;
+      Edge e;
+      e.vertex_set = Graph::VERTEX_MASKS[Graph::K].masks[r];
+      e.head_vertex = UNDIRECTED;
+      if (rng() % 2 == 0) {
+        uint16 bits = e.vertex_set;
+        for (int skip = rng() % Graph::K; skip > 0; skip--) bits &= bits - 1;
+        e.head_vertex = __builtin_ctz(bits);
+      }
+      graphs[i].add_edge(e);
+    }
+  }
+  return graphs;
+}
+
+// Calls contains(g, v) for all graphs and vertices, and stores the results. Returns the average
+// number of nanoseconds per call.
+template <typename ContainsFn>
+double time_calls(std::vector<Graph>& graphs, ContainsFn contains, std::vector<bool>& results) {
+  results.clear();
+  const auto start = std::chrono::steady_clock::now();
+  for (Graph& g : graphs) {
+    for (int v = 0; v < Graph::N; v++) results.push_back(contains(g, v));
+  }
+  const auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() / results.size();
+}
+
+template <typename ContainsFn>
+void benchmark(const std::string& f, SubgraphMode mode, int k, int n, ContainsFn contains) {
+  Graph::set_global_graph_info(k, n);
+  ForbiddenPattern pattern;
+  if (!ForbiddenPattern::compile(f, mode, pattern)) {
+    std::cout << "Failed to compile " << f << "\n";
+    exit(-1);
+  }
+  std::vector<Graph> graphs = random_graphs(200000 / n);
+  std::vector<bool> expected, actual;
+  const double kernel_ns = time_calls(graphs, contains, expected);
+  const double pattern_ns =
+      time_calls(graphs, [&pattern](Graph& g, int v) { return pattern.contains(g, v); }, actual);
+  if (expected != actual) {
+    std::cout << "Mismatch on " << f << "\n";
+    exit(-1);
+  }
+  std::cout << "K=" << k << " N=" << n << " F=" << f << " ("
+            << 100 * std::count(expected.begin(), expected.end(), true) / expected.size()
+            << "% contain F): hand-written " << kernel_ns << " ns, pattern " << pattern_ns
+            << " ns, ratio " << pattern_ns / kernel_ns << "\n";
+}
+
+int main() {
+  std::cout << std::fixed << std::setprecision(1);
+  for (int n = 5; n <= 8; n++) {
+    benchmark("{12, 13, 23>3}", SubgraphMode::FORGET_DIRECTION, 2, n, contains_Tk);
+  }
+  for (int n = 5; n <= 7; n++) {
+    benchmark("{124, 134, 234>3}", SubgraphMode::FORGET_DIRECTION, 3, n, contains_Tk);
+  }
+  benchmark("{1245, 1345, 2345>3}", SubgraphMode::FORGET_DIRECTION, 4, 7, contains_Tk);
+  for (int n = 5; n <= 8; n++) {
+    benchmark("{01, 02, 03, 12, 13, 23>3}", SubgraphMode::FORGET_DIRECTION, 2, n, contains_K4);
+    benchmark("{01>1, 02>2, 03>3, 12>2, 13>3, 23>3}", SubgraphMode::ORIENT_UNDIRECTED, 2, n,
+              contains_K4D0);
+    benchmark("{01, 02, 03, 12>2, 13>3, 23>3}", SubgraphMode::ORIENT_UNDIRECTED, 2, n,
+              contains_K4D3);
+  }
+  return 0;
+}
@@ -15,6 +15,44 @@
 bool contains_Tk(const Graph& g, int v) {
   Counters::increment_graph_contains_Tk_tests();
 
+  // edge_index[r] is 1 + the index of the edge with rank r in g, or 0 if there is no such edge.
+  // It's all 0 between the calls, so that it only takes O(E) to set up and clear.
+  static thread_local uint8 edge_index[compute_binom(MAX_VERTICES, MAX_VERTICES / 2)];
+  for (int i = 0; i < g.edge_count; i++) {
+    edge_index[Graph::EDGE_RANKS[g.edges[i].vertex_set]] = i + 1;
+  }
+
+  // Any T_k with vertex v has an edge e containing v, so look up the possible T_k of each e.
+  bool found = false;
+  for (int i = 0; i < g.edge_count && !found; i++) {
+    const Edge& e = g.edges[i];
+    if ((e.vertex_set & (1 << v)) == 0) continue;
+    for (const TkTriangle& t : Graph::TK_TRIANGLES[Graph::EDGE_RANKS[e.vertex_set]]) {
+      const int a = edge_index[t.rank_a];
+      const int b = edge_index[t.rank_b];
+      if (a == 0 || b == 0) continue;
+      const uint8 head_a = g.edges[a - 1].head_vertex;
+      const uint8 head_b = g.edges[b - 1].head_vertex;
+      if ((e.head_vertex != UNDIRECTED && (t.triangle & (1 << e.head_vertex)) != 0) ||
+          (head_a != UNDIRECTED && (t.triangle & (1 << head_a)) != 0) ||
+          (head_b != UNDIRECTED && (t.triangle & (1 << head_b)) != 0)) {
+        found = true;
+        break;
+      }
+    }
+  }
+
+  for (int i = 0; i < g.edge_count; i++) {
+    edge_index[Graph::EDGE_RANKS[g.edges[i].vertex_set]] = 0;
+  }
+  return found;
+}
+
+// Same as contains_Tk(), but searches all pairs of edges containing v without the precomputed
+// tables. Only used to verify contains_Tk() in tests.
+bool contains_Tk_slow(const Graph& g, int v) {
+  Counters::increment_graph_contains_Tk_tests();
+
   // There are two possibilities that $v \in T_k \subseteq H$.
   // (1) v is in the "triangle with stem cut off". Namely:
   //     exists vertices $x,y$, and vertex set $S$ with size $K-2$, $S$ disjoint
@@ -70,3 +108,43 @@ bool contains_Tk(const Graph& g, int v) {
   }
   return false;
 }
+
+// Returns true if the graph contains T_k as a subgraph, where the edge with the given vertex set
+// is one of the 3 edges of the T_k subgraph. Returns false if there is no such edge in g.
+bool contains_Tk_with_edge(const Graph& g, uint16 e) {
+  Counters::increment_graph_contains_Tk_tests();
+
+  // The other two edges of a T_k with e share K-1 vertices with e, and they are in the same
+  // (K+1)-set U = e | f. So first collect the edges sharing K-1 vertices with e, then check the
+  // pairs among them with the same U. Using the same notation as in contains_Tk(), if
+  // e = U-{x}, f1 = U-{y}, f2 = U-{z}, then stem = e & f1 & f2, and xyz = U & ~stem.
+  int e_idx = -1;
+  int adjacent_count = 0;
+  uint8 adjacent[MAX_EDGES];  // Indices of the edges sharing K-1 vertices with e.
+  for (int i = 0; i < g.edge_count; i++) {
+    const uint16 f = g.edges[i].vertex_set;
+    if (f == e) {
+      e_idx = i;
+    } else if (__builtin_popcount(f ^ e) == 2) {
+      adjacent[adjacent_count++] = i;
+    }
+  }
+  if (e_idx < 0) return false;
+
+  const uint8 e_head = g.edges[e_idx].head_vertex;
+  for (int i = 0; i < adjacent_count; i++) {
+    const Edge& f1 = g.edges[adjacent[i]];
+    const uint16 u = e | f1.vertex_set;
+    for (int j = i + 1; j < adjacent_count; j++) {
+      const Edge& f2 = g.edges[adjacent[j]];
+      if ((e | f2.vertex_set) != u) continue;
+      const uint16 xyz = u & ~(e & f1.vertex_set & f2.vertex_set);
+      if ((e_head != UNDIRECTED && (xyz & (1 << e_head)) != 0) ||
+          (f1.head_vertex != UNDIRECTED && (xyz & (1 << f1.head_vertex)) != 0) ||
+          (f2.head_vertex != UNDIRECTED && (xyz & (1 << f2.head_vertex)) != 0)) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
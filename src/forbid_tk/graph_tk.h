@@ -15,9 +15,26 @@
 // (3) changing directed edges to undirected by forgetting directions.
 bool contains_Tk(const Graph& g, int v);
 
-// Derived class to manage the growth search, for T_k-free problem.
-class GrowerTk : public Grower {
-  using Grower::Grower;  // Inherite the constructor from the base class.
-  Fraction get_ratio(const Graph& g) const override { return g.get_theta_ratio(); }
-  bool contains_forbidden_subgraph(Graph& g, int v) const override { return contains_Tk(g, v); }
-};
\ No newline at end of file
+// Same as contains_Tk(), but without the precomputed tables of Graph. Only used in tests.
+bool contains_Tk_slow(const Graph& g, int v);
+
+// Returns true if the graph contains T_k as a subgraph, where the edge with the given vertex set
+// is one of the 3 edges of the T_k subgraph. Returns false if there is no such edge in g.
+// Only the edges sharing K-1 vertices with the given edge are checked, so it's O(E) instead of
+// the O(E^3) of contains_Tk().
+bool contains_Tk_with_edge(const Graph& g, uint16 e);
+
+// Grower policy of the T_k-free problem, see `Grower`.
+struct TkPolicy : GrowerPolicy {
+  std::string get_problem_name() const { return "tk"; }
+  Fraction get_ratio(const Graph& g) const { return g.get_theta_ratio(); }
+  RatioBoundFn get_ratio_bound() const { return &Graph::get_theta_ratio_bound; }
+  bool contains_forbidden_subgraph(Graph& g, int v) const { return contains_Tk(g, v); }
+  bool contains_forbidden_subgraph_with_edge(Graph& g, uint16 edge) const {
+    return contains_Tk_with_edge(g, edge);
+  }
+  bool forbids_Tk() const { return true; }
+};
+
+// Manages the growth search, for T_k-free problem.
+using GrowerTk = Grower<TkPolicy>;
\ No newline at end of file
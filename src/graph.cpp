@@ -100,6 +100,10 @@ int Graph::N = 0;
 int Graph::TOTAL_EDGES = 0;
 // Global to all graph instances: pre-computed the vertex masks, used in various computations.
 VertexMask Graph::VERTEX_MASKS[MAX_VERTICES + 1]{0};
+// Global to all graph instances: the rank of each K-vertex set.
+uint16 Graph::EDGE_RANKS[1 << MAX_VERTICES]{0};
+// Global to all graph instances: the possible T_k containing each edge.
+std::vector<TkTriangle> Graph::TK_TRIANGLES[compute_binom(MAX_VERTICES, MAX_VERTICES / 2)];
 
 void Graph::set_global_graph_info(int k, int n) {
   K = k;
@@ -115,6 +119,28 @@ void Graph::set_global_graph_info(int k, int n) {
     }
     assert(mask.mask_count == compute_binom(n, m));
   }
+
+  const VertexMask& edges = VERTEX_MASKS[k];
+  for (int r = 0; r < edges.mask_count; r++) {
+    EDGE_RANKS[edges.masks[r]] = r;
+  }
+  for (int r = 0; r < edges.mask_count; r++) {
+    const uint16 e = edges.masks[r];
+    std::vector<TkTriangle>& triangles = TK_TRIANGLES[r];
+    triangles.clear();
+    for (int b = 0; b < n; b++) {
+      if ((e & (1 << b)) != 0) continue;
+      for (int a1 = 0; a1 < n; a1++) {
+        if ((e & (1 << a1)) == 0) continue;
+        for (int a2 = a1 + 1; a2 < n; a2++) {
+          if ((e & (1 << a2)) == 0) continue;
+          const uint16 u = e | (1 << b);
+          triangles.push_back(TkTriangle{EDGE_RANKS[u & ~(1 << a1)], EDGE_RANKS[u & ~(1 << a2)],
+                                         static_cast<uint16>((1 << a1) | (1 << a2) | (1 << b))});
+        }
+      }
+    }
+  }
 }
 
 Graph::Graph() : graph_hash(0), is_canonical(false), edge_count(0), undirected_edge_count(0) {}
@@ -141,6 +167,36 @@ Fraction Graph::get_zeta_ratio() const {
   }
 }
 
+// Returns a lower bound of theta_ratio over the graphs with the given edge counts plus new edges.
+//
+// Since theta_ratio >= 1 (undirected + directed <= binom_nk), it doesn't increase when a new
+// edge is added, or when a new undirected edge becomes directed. So the bound is reached with
+// max_new_directed directed edges and (max_new_edges - max_new_directed) undirected edges.
+Fraction Graph::get_theta_ratio_bound(int undirected, int directed, int max_new_edges,
+                                      int max_new_directed) {
+  directed += max_new_directed;
+  undirected += max_new_edges - max_new_directed;
+  if (directed > 0) {
+    return Fraction(TOTAL_EDGES - undirected, directed);
+  } else {
+    return Fraction::infinity();
+  }
+}
+
+// Returns a lower bound of zeta_ratio over the graphs with the given edge counts plus new edges.
+//
+// Same as above with the roles of the edge counts swapped: the bound is reached with all
+// max_new_edges new edges undirected, regardless of max_new_directed.
+Fraction Graph::get_zeta_ratio_bound(int undirected, int directed, int max_new_edges,
+                                     int /*max_new_directed*/) {
+  undirected += max_new_edges;
+  if (undirected > 0) {
+    return Fraction(TOTAL_EDGES - directed, undirected);
+  } else {
+    return Fraction::infinity();
+  }
+}
+
 // Returns the hash of this graph.
 uint32 Graph::get_graph_hash() const {
   assert(is_canonical);
@@ -169,6 +225,27 @@ void Graph::add_edge(Edge edge) {
   }
 }
 
+// Computes the neighbor bitsets of all vertices. Only works for K=2.
+void Graph::get_neighbor_sets(NeighborSets& result) const {
+  assert(K == 2);
+  std::fill(result.undirected, result.undirected + MAX_VERTICES, 0);
+  std::fill(result.out, result.out + MAX_VERTICES, 0);
+  std::fill(result.in, result.in + MAX_VERTICES, 0);
+  for (int i = 0; i < edge_count; i++) {
+    const int a = __builtin_ctz(edges[i].vertex_set);
+    const int b = 31 - __builtin_clz(edges[i].vertex_set);
+    const uint8 head = edges[i].head_vertex;
+    if (head == UNDIRECTED) {
+      result.undirected[a] |= 1 << b;
+      result.undirected[b] |= 1 << a;
+    } else {
+      const int tail = head == a ? b : a;
+      result.out[tail] |= 1 << head;
+      result.in[head] |= 1 << tail;
+    }
+  }
+}
+
 // Initializes everything in this graph from the edge set.
 void Graph::compute_vertex_signature() {
   Counters::increment_compute_vertex_signatures();
@@ -406,6 +483,113 @@ bool Graph::is_identical(const Graph& other) const {
   return true;
 }
 
+bool Graph::is_canonical_augmentation(int n) const {
+  assert(K <= n && n <= MAX_VERTICES);
+  // The role of vertex v in edge e: 0 if undirected, 1 if the head, 2 if a tail.
+  auto role = [](const Edge& e, int v) -> uint64 {
+    return e.head_vertex == UNDIRECTED ? 0 : e.head_vertex == v ? 1 : 2;
+  };
+  // Start from the degrees, and refine each vertex by the invariants of its edges until the
+  // number of distinct invariants stops growing.
+  uint64 invariant[MAX_VERTICES] = {};
+  int degree[MAX_VERTICES] = {};
+  for (int i = 0; i < edge_count; i++) {
+    for (int v = 0; v < n; v++) {
+      if ((edges[i].vertex_set & (1 << v)) == 0) continue;
+      degree[v]++;
+      invariant[v] += 1ULL << (16 * role(edges[i], v));
+    }
+  }
+  for (int v = 0; v < n; v++) {
+    if (degree[v] == 0) return false;
+  }
+  auto count_distinct = [n](const uint64* values) {
+    std::vector<uint64> sorted(values, values + n);
+    std::sort(sorted.begin(), sorted.end());
+    return std::unique(sorted.begin(), sorted.end()) - sorted.begin();
+  };
+  std::vector<uint64> edge_codes, others;
+  for (auto cells = count_distinct(invariant);;) {
+    uint64 refined[MAX_VERTICES];
+    for (int v = 0; v < n; v++) {
+      edge_codes.clear();
+      for (int i = 0; i < edge_count; i++) {
+        if ((edges[i].vertex_set & (1 << v)) == 0) continue;
+        others.clear();
+        for (int w = 0; w < n; w++) {
+          if (w != v && (edges[i].vertex_set & (1 << w)) != 0) {
+            others.push_back(hash_combine64(invariant[w], role(edges[i], w)));
+          }
+        }
+        std::sort(others.begin(), others.end());
+        uint64 code = role(edges[i], v);
+        for (uint64 o : others) code = hash_combine64(code, o);
+        edge_codes.push_back(code);
+      }
+      std::sort(edge_codes.begin(), edge_codes.end());
+      refined[v] = invariant[v];
+      for (uint64 c : edge_codes) refined[v] = hash_combine64(refined[v], c);
+    }
+    std::copy(refined, refined + n, invariant);
+    const auto refined_cells = count_distinct(invariant);
+    if (refined_cells == cells) break;
+    cells = refined_cells;
+  }
+
+  // The vertices in the order of the invariants, and the cell of the vertex to delete: the last
+  // one whose vertices leave an edge when deleted.
+  std::vector<int> order(n);
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&invariant](int a, int b) {
+    return invariant[a] != invariant[b] ? invariant[a] > invariant[b] : a < b;
+  });
+  int cell_end = n;
+  while (n > K && degree[order[cell_end - 1]] == edge_count) cell_end--;
+  int cell_start = cell_end - 1;
+  while (cell_start > 0 && invariant[order[cell_start - 1]] == invariant[order[cell_end - 1]]) {
+    cell_start--;
+  }
+  if (invariant[n - 1] != invariant[order[cell_end - 1]]) return false;
+  if (cell_end - cell_start == 1) return true;
+
+  // Permute the vertices within each cell, and accept if any labeling with the smallest edge list
+  // puts vertex n-1 last in its cell.
+  std::vector<std::pair<int, int>> cell_ranges;
+  for (int a = 0, b; a < n; a = b) {
+    for (b = a + 1; b < n && invariant[order[b]] == invariant[order[a]];) b++;
+    if (b - a > 1) cell_ranges.push_back({a, b});
+  }
+  std::vector<uint16> best, codes(edge_count);
+  bool accepted = false;
+  while (true) {
+    int label[MAX_VERTICES];
+    for (int i = 0; i < n; i++) label[order[i]] = i;
+    for (int i = 0; i < edge_count; i++) {
+      uint16 vertex_set = 0;
+      for (int v = 0; v < n; v++) {
+        if ((edges[i].vertex_set & (1 << v)) != 0) vertex_set |= 1 << label[v];
+      }
+      const uint8 head = edges[i].head_vertex;
+      codes[i] = vertex_set << 4 | (head == UNDIRECTED ? UNDIRECTED : label[head]);
+    }
+    std::sort(codes.begin(), codes.end());
+    if (best.empty() || codes < best) {
+      best = codes;
+      accepted = order[cell_end - 1] == n - 1;
+    } else if (codes == best) {
+      accepted |= order[cell_end - 1] == n - 1;
+    }
+    size_t c = 0;
+    while (c < cell_ranges.size() &&
+           !std::next_permutation(order.begin() + cell_ranges[c].first,
+                                  order.begin() + cell_ranges[c].second)) {
+      c++;
+    }
+    if (c == cell_ranges.size()) break;
+  }
+  return accepted;
+}
+
 // Used to establish a deterministic order when growing the search tree.
 // Since this is called infrequently, its speed is not important. We want deterministic behavior
 // and an intuitive ordering for human inspection of the detailed log.
@@ -72,6 +72,29 @@ struct VertexMask {
   uint16 masks[compute_binom(12, 6)];
 };
 
+// The neighbors of each vertex in a 2-PDG (K=2) as bitmasks, see `Graph::get_neighbor_sets()`.
+// Used to search for small subgraphs with bitwise operations.
+struct NeighborSets {
+  // undirected[u] is the bitmask of the vertices w such that uw is an undirected edge.
+  uint16 undirected[MAX_VERTICES];
+  // out[u] is the bitmask of the vertices w such that uw is a directed edge with head w.
+  uint16 out[MAX_VERTICES];
+  // in[u] is the bitmask of the vertices w such that uw is a directed edge with head u.
+  uint16 in[MAX_VERTICES];
+
+  // Returns the bitmask of all neighbors of u.
+  uint16 all(int u) const { return undirected[u] | out[u] | in[u]; }
+};
+
+// A possible T_k containing a given edge e, see `Graph::TK_TRIANGLES`.
+struct TkTriangle {
+  // The ranks (indices in Graph::VERTEX_MASKS[K].masks) of the other two edges.
+  uint16 rank_a;
+  uint16 rank_b;
+  // Bitmask of {x,y,z}. The three edges form T_k iff one of them has its head in it.
+  uint16 triangle;
+};
+
 // Represents a k-PDG, with the data structure optimized for computing isomorphisms.
 // The n vertices in this graph: 0, 1, ..., n-1.
 struct Graph {
@@ -85,8 +108,15 @@ struct Graph {
   // Global to all graph instances: pre-computed the vertex masks, used in
   // various computations including compute_codegree_signature().
   static VertexMask VERTEX_MASKS[MAX_VERTICES + 1];
-
-  // Set the values of K, N, and TOTAL_EDGES.
+  // Global to all graph instances: EDGE_RANKS[s] is the rank of the K-vertex set s, namely its
+  // index in VERTEX_MASKS[K].masks, used to index edges in compact tables.
+  static uint16 EDGE_RANKS[1 << MAX_VERTICES];
+  // Global to all graph instances: TK_TRIANGLES[r] holds all possible T_k containing the edge e
+  // of rank r. For vertices a1, a2 in e and b not in e, the other two edges are e-{a1}+{b} and
+  // e-{a2}+{b}, and {x,y,z} = {a1,a2,b}. Used in contains_Tk().
+  static std::vector<TkTriangle> TK_TRIANGLES[compute_binom(MAX_VERTICES, MAX_VERTICES / 2)];
+
+  // Set the values of K, N, and TOTAL_EDGES, and computes the tables above.
   static void set_global_graph_info(int k, int n);
 
   // Parses the edge representation into a Graph object. Returns true if successful.
@@ -123,6 +153,14 @@ struct Graph {
   // In case undirected edge count is 0, Fraction::infinity() is returned.
   Fraction get_zeta_ratio() const;
 
+  // Returns a lower bound of theta_ratio (or zeta_ratio) over the graphs with (undirected + a)
+  // undirected edges and (directed + c) directed edges, for all a, c >= 0 such that
+  // c <= max_new_directed and a + c <= max_new_edges. See `RatioBoundFn`.
+  static Fraction get_theta_ratio_bound(int undirected, int directed, int max_new_edges,
+                                        int max_new_directed);
+  static Fraction get_zeta_ratio_bound(int undirected, int directed, int max_new_edges,
+                                       int max_new_directed);
+
   // Returns the hash of this graph.
   uint32 get_graph_hash() const;
   // Several functions to get the edge counts.
@@ -134,6 +172,9 @@ struct Graph {
   // to be added to the graph (this vertex set does not yet exist in the edges).
   bool edge_allowed(uint16 vertices) const;
 
+  // Computes the neighbor bitsets of all vertices in O(E). Only works for 2-PDGs (K=2).
+  void get_neighbor_sets(NeighborSets& result) const;
+
   // Adds an edge to the graph. It's caller's responsibility to make sure this is allowed.
   // And the input is consistent (head is inside the vertex set).
   void add_edge(Edge edge);
@@ -158,6 +199,18 @@ struct Graph {
   // Returns true if the two graphs are identical (exactly same edge sets).
   bool is_identical(const Graph& other) const;
 
+  // Returns true if this graph with vertices 0, 1, ..., n-1, where vertex n-1 was just added by
+  // the growth phase, is the canonical augmentation of its parent in McKay's orderly generation:
+  // no vertex is isolated, and vertex n-1 is in the orbit of the vertex the canonical labeling
+  // puts last among the vertices whose deletion leaves an edge (any vertex if n == K). Then every
+  // isomorphism class without isolated vertices is accepted from exactly one parent class, see
+  // `GrowerBase::set_orderly_generation()`. The graph doesn't need to be canonicalized.
+  //
+  // The canonical labeling is the one with the smallest sorted edge list, among the labelings
+  // ordering the vertices by an invariant refined from the degrees (1-dimensional
+  // Weisfeiler-Leman), so only the vertices with equal invariants are permuted.
+  bool is_canonical_augmentation(int n) const;
+
   // Print the graph to the output stream for debugging purpose.
   // If aligned==true, pad the undirected edges, so the print is easier to read.
   void print_concise(std::ostream& os, bool aligned) const;
@@ -198,9 +251,12 @@ struct Graph {
 
   // Friend declarations for the "contains_xys" functions.
   friend bool contains_Tk(const Graph& g, int v);
-  friend bool contains_K4(const Graph&, int v);
-  friend bool contains_K4D0(Graph&, int);
-  friend bool contains_K4D3(Graph&, int);
+  friend bool contains_Tk_slow(const Graph& g, int v);
+  friend bool contains_Tk_with_edge(const Graph&, uint16);
+  // EdgeGenerator reads the edges of the base graph directly.
+  friend class EdgeGenerator;
+  // ForbiddenPattern reads the edges of both F and the graph to search in directly.
+  friend class ForbiddenPattern;
 
   // Friend declarations that allows unit testing of some private implementations.
 #define FRIEND_TEST(test_case_name, test_name) friend class test_case_name##_##test_name##_Test
@@ -225,3 +281,30 @@ struct Graph {
   friend class IsomorphismStressTest;
 };
 static_assert(sizeof(Graph) == 196);
+
+// Custom hash and compare for the Graph type. Treat isomorphic graphs as being equal.
+struct GraphHasher {
+  size_t operator()(const Graph& g) const { return g.get_graph_hash(); }
+};
+struct GraphComparer {
+  bool operator()(const Graph& g, const Graph& h) const { return g.is_isomorphic(h); }
+};
+
+// A read-only view of consecutive graphs, either in a vector or in a mapped file (see
+// `GrowthSnapshot`), so that the mapped graphs are used without copying them.
+class GraphSpan {
+ public:
+  GraphSpan() = default;
+  GraphSpan(const Graph* graphs, size_t count) : first(graphs), count(count) {}
+  GraphSpan(const std::vector<Graph>& graphs) : first(graphs.data()), count(graphs.size()) {}
+
+  const Graph* begin() const { return first; }
+  const Graph* end() const { return first + count; }
+  size_t size() const { return count; }
+  bool empty() const { return count == 0; }
+  const Graph& operator[](size_t i) const { return first[i]; }
+
+ private:
+  const Graph* first = nullptr;
+  size_t count = 0;
+};
@@ -1,19 +1,10 @@
 #include "grower.h"
 
-#include "counters.h"
-#include "fraction.h"
+std::atomic<bool> GrowerBase::stop_requested(false);
 
-// Custom hash and compare for the Graph type. Treat isomorphic graphs as being equal.
-struct GraphHasher {
-  size_t operator()(const Graph& g) const { return g.get_graph_hash(); }
-};
-struct GraphComparer {
-  bool operator()(const Graph& g, const Graph& h) const { return g.is_isomorphic(h); }
-};
-
-Grower::Grower(int num_worker_threads_, bool skip_final_enum_, bool use_min_theta_opt_,
-               bool use_contains_Tk_opt_, int start_idx_, int end_idx_, bool search_ratio_graph_,
-               Fraction ratio_to_search_)
+GrowerBase::GrowerBase(int num_worker_threads_, bool skip_final_enum_, bool use_min_theta_opt_,
+                       bool use_contains_Tk_opt_, int start_idx_, int end_idx_,
+                       bool search_ratio_graph_, Fraction ratio_to_search_)
     : num_worker_threads(num_worker_threads_),
       skip_final_enum(skip_final_enum_),
       use_min_theta_opt(use_min_theta_opt_),
@@ -25,275 +16,522 @@ Grower::Grower(int num_worker_threads_, bool skip_final_enum_, bool use_min_thet
       log(nullptr),
       log_detail(nullptr),
       log_result(nullptr),
-      to_be_processed_id(start_idx_) {}
+      prefix_digits(0),
+      base_graph_count(0) {}
 
-void Grower::set_logging(std::ostream* summary, std::ostream* detail, std::ostream* result) {
+void GrowerBase::set_logging(std::ostream* summary, std::ostream* detail, std::ostream* result,
+                             std::ostream* perf) {
   log = summary;
   log_detail = detail;
   log_result = result;
+  log_perf = perf;
 }
 
-void Grower::set_stats_print_interval(uint64 check_every_n_gen, int print_every_n_seconds) {
-  stats_check_every_n_gen = check_every_n_gen;
+void GrowerBase::set_stats_print_interval(int print_every_n_seconds) {
   stats_print_every_n_seconds = print_every_n_seconds;
 }
 
-// Find all canonical isomorphism class representations with up to max_n vertices.
-void Grower::grow() {
-  assert(Graph::N <= MAX_VERTICES);
-
-  // Initialize empty graph with k-1 vertices.
-  std::vector<Graph> collected_graphs[MAX_VERTICES];
-  Graph g;
-  g.canonicalize();
-  collected_graphs[Graph::K - 1].push_back(g);
-  Counters::observe_ratio(g, get_ratio(g));
+void GrowerBase::set_checkpoint(const std::string& path, int interval_seconds, bool resume) {
+  checkpoint_path = path;
+  checkpoint_interval_seconds = interval_seconds;
+  resume_from_checkpoint = resume;
+}
 
-  // First grow to N-1 vertices, accumulate one graph from each isomorphic class.
-  for (int n = Graph::K; n < Graph::N; n++) {
-    collected_graphs[n] = grow_step(n, collected_graphs[n - 1]);
+GrowerBase::BaseGraphJob::BaseGraphJob(int base_graph_id_, const Graph& base_)
+    : base_graph_id(base_graph_id_),
+      base(base_),
+      pending_ranges(1),
+      shared_min_ratio(pack_fraction(Fraction::infinity())),
+      min_ratio(Fraction::infinity()),
+      min_ratio_range_begin(0) {}
+
+void GrowerBase::prepare_final_step(GraphSpan base_graphs) {
+  base_graph_count = static_cast<int>(base_graphs.size());
+  int max_idx = base_graph_count;
+  if (end_idx > 0 && end_idx < max_idx) {
+    max_idx = end_idx + 1;
   }
-  Counters::print_counters();
-  print_before_final(collected_graphs);
-
-  if (!skip_final_enum) {
-    // Finally, enumerate all graphs with N vertices, no need to store graphs.
-    enumerate_final_step(collected_graphs[Graph::N - 1]);
-    std::sort(results.begin(), results.end());
-    if (log_result != nullptr && !search_ratio_graph) {
-      for (const auto& r : results) {
-        int base_graph_id = std::get<0>(r);
-        const Graph& base_graph = std::get<1>(r);
-        const Graph& min_ratio_graph = std::get<2>(r);
-        // If the graph's ratio is the global minimum, print into the result log.
-        if (get_ratio(min_ratio_graph) == Counters::get_min_ratio()) {
-          *log_result << "G[" << base_graph_id
-                      << "] min_ratio=" << get_ratio(min_ratio_graph).to_string() << "\n  ";
-          base_graph.print_concise(*log_result, true);
-          *log_result << "  ";
-          min_ratio_graph.print_concise(*log_result, true);
-        }
-      }
-      log_result->flush();
+  // As a worker, the jobs are created when the coordinator hands out their ids.
+  if (coordinator_address.empty()) {
+    for (int i = start_idx; i < max_idx; i++) {
+      jobs.emplace_back(i, base_graphs[i]);
     }
-  } else {
-    std::cout << "Skipped.\n";
   }
-}
-
-// Constructs all non-isomorphic graphs with n vertices that are T_k-free,
-// and add them to the canonicals. Before calling this, all such graphs
-// with <n vertices must already be in the canonicals.
-// Note all edges added in this step contains vertex (n-1).
-std::vector<Graph> Grower::grow_step(int n, const std::vector<Graph>& base_graphs) {
-  assert(n < Graph::N);
-  EdgeCandidates edge_candidates(n);
-  Counters::new_growth_step(n, base_graphs.size());
-  std::unordered_set<Graph, GraphHasher, GraphComparer> results;
+  Counters::enter_final_step(jobs.size());
+  if (search_ratio_graph) {
+    Counters::initialize_ratio_graph_search(ratio_to_search);
+  }
 
-  // Add all non-empty graphs from the previous step to the results.
-  for (const Graph& g : base_graphs) {
-    if (g.get_edge_count() > 0) {
-      results.insert(g);
+  // Split each base graph into enough prefix ranges so that the work can be balanced among the
+  // threads, but no more than needed, since each range has a small overhead. When there is only
+  // one thread, the base graphs are not split.
+  prefix_digits = 0;
+  const int edge_candidate_count = EdgeCandidates(Graph::N).edge_candidate_count;
+  if (num_worker_threads > 1) {
+    const uint32 min_prefix_count = 16 * num_worker_threads;
+    while (prefix_digits < edge_candidate_count - 1 &&
+           EdgeGenerator::get_prefix_count(prefix_digits) < min_prefix_count) {
+      prefix_digits++;
     }
   }
+  worker_slots = std::make_unique<WorkerSlot[]>(std::max(num_worker_threads, 1));
+  worker_stats = std::make_unique<WorkerStats[]>(std::max(num_worker_threads, 1));
+}
 
-  // This data structure will be reused when processing the graphs.
-  Graph copy;
-
-  for (const Graph& g : base_graphs) {
-    Counters::increment_growth_processed_graphs_in_current_step();
-    EdgeGenerator edge_gen(edge_candidates, g);
+void GrowerBase::monitor_thread_main() {
+  const int slot_count = std::max(num_worker_threads, 1);
+  const auto print_interval = std::chrono::seconds(stats_print_every_n_seconds);
+  auto sleep_time = std::chrono::duration_cast<std::chrono::milliseconds>(print_interval);
+  if (!checkpoint_path.empty()) {
+    sleep_time = std::min<std::chrono::milliseconds>(
+        sleep_time, std::chrono::seconds(SAVE_PROGRESS_EVERY_N_SECONDS));
+  }
+  sleep_time = std::max(sleep_time, std::chrono::milliseconds(MONITOR_MIN_SLEEP_MILLISECONDS));
+  auto last_print_time = std::chrono::steady_clock::now();
+  uint64 last_generated = 0;
+  std::vector<uint64> last_processed(slot_count, 0);
 
-    // Loop through all ((K+1)^\binom{n-1}{k-1} - 1) edge combinations, add them to g, and check
-    // add to canonicals unless it's isomorphic to an existing one.
-    while (edge_gen.next(copy)) {
-      if (contains_forbidden_subgraph(copy, n - 1)) {
-        edge_gen.notify_contain_tk_skip();
-        continue;
+  std::unique_lock lock(monitor_mutex);
+  while (true) {
+    // The last print after the workers are done has the totals of the phase.
+    const bool stopping = monitor_cv.wait_for(lock, sleep_time, [this] { return monitor_stop; });
+    if (!stopping && !checkpoint_path.empty()) {
+      for (int i = 0; i < slot_count; i++) {
+        worker_stats[i].save_requested.store(true, std::memory_order_relaxed);
       }
-
-      copy.canonicalize();
-
-      if (results.find(copy) == results.cend()) {
-        results.insert(copy);
-        Counters::observe_ratio(copy, get_ratio(copy));
+    }
+    const auto now = std::chrono::steady_clock::now();
+    if (!stopping && now - last_print_time < print_interval) continue;
+    const double seconds =
+        std::max(std::chrono::duration<double>(now - last_print_time).count(), 1e-3);
+    last_print_time = now;
+
+    // The rates are over the time since the last print.
+    uint64 total_generated = 0;
+    uint64 total_processed = 0;
+    uint64 new_processed = 0;
+    std::ostringstream workers;
+    for (int i = 0; i < slot_count; i++) {
+      const WorkerStats& stats = worker_stats[i];
+      const int base_graph_id = stats.base_graph_id.load(std::memory_order_relaxed);
+      const uint64 processed = stats.graphs_processed.load(std::memory_order_relaxed);
+      total_generated += stats.graphs_generated.load(std::memory_order_relaxed);
+      total_processed += processed;
+      new_processed += processed - last_processed[i];
+      workers << (i == 0 ? "" : ", ") << i << ": ";
+      if (base_graph_id >= 0) {
+        workers << "G[" << base_graph_id << "] "
+                << static_cast<uint64>((processed - last_processed[i]) / seconds) << "/s";
+      } else {
+        workers << "idle";
       }
+      last_processed[i] = processed;
     }
+    const uint64 generated_rate = static_cast<uint64>((total_generated - last_generated) / seconds);
+    last_generated = total_generated;
+
+    std::scoped_lock counters_lock(counters_mutex);
+    std::ostringstream line;
+    line << "Final step: " << results.size() << " base graphs done, " << total_processed
+         << " graphs (" << static_cast<uint64>(new_processed / seconds) << "/s), "
+         << total_generated << " generated (" << generated_rate << "/s)\n"
+         << "  Workers: " << workers.str() << "\n";
+    std::cout << line.str();
+    if (log != nullptr) {
+      *log << line.str();
+    }
+    Counters::print_at_time_interval();
+    if (stopping) break;
   }
-
-  std::vector<Graph> new_graphs(results.cbegin(), results.cend());
-  std::sort(new_graphs.begin(), new_graphs.end());
-  return new_graphs;
 }
 
-void Grower::enumerate_final_step(const std::vector<Graph>& base_graphs) {
-  int max_idx = static_cast<int>(base_graphs.size());
-  if (end_idx > 0 && end_idx < max_idx) {
-    max_idx = end_idx + 1;
-  }
-  for (int i = start_idx; i < max_idx; i++) {
-    to_be_processed.push(base_graphs[i]);
+void GrowerBase::schedule_jobs(const std::vector<double>& costs) {
+  std::vector<int> order(jobs.size());
+  std::iota(order.begin(), order.end(), 0);
+  if (!costs.empty()) {
+    std::stable_sort(order.begin(), order.end(),
+                     [&costs](int a, int b) { return costs[a] > costs[b]; });
   }
-  Counters::enter_final_step(to_be_processed.size());
-  if (search_ratio_graph) {
-    Counters::initialize_ratio_graph_search(ratio_to_search);
+  const int slot_count = std::max(num_worker_threads, 1);
+  int next_slot = 0;
+  for (int i : order) {
+    // The base graphs completed before the checkpoint have no pending ranges.
+    for (int r = 0; r < jobs[i].pending_ranges; r++) {
+      worker_slots[next_slot].queue.push_back(&jobs[i]);
+      next_slot = (next_slot + 1) % slot_count;
+    }
   }
+}
 
-  if (num_worker_threads == 0) {
-    worker_thread_main(0);
+bool GrowerBase::acquire_work(int thread_id, BaseGraphJob*& job,
+                              std::unique_ptr<EnumRange>& range) {
+  std::unique_lock lock(counters_mutex);
+  WorkerSlot& own_slot = worker_slots[thread_id];
+  RangeProgress& progress = own_slot.progress;
+  job = nullptr;
+  if (!own_slot.queue.empty()) {
+    job = own_slot.queue.front();
+    own_slot.queue.pop_front();
   } else {
-    // The worker threads used in the final enumeration phase.
-    std::vector<std::thread> worker_threads;
-
-    // Start the threads.
+    // The own queue is empty, try to steal the last base graph from the longest queue.
+    int victim = -1;
+    size_t max_queued = 0;
     for (int i = 0; i < num_worker_threads; i++) {
-      worker_threads.push_back(std::thread(&Grower::worker_thread_main, this, i));
+      if (i != thread_id && worker_slots[i].queue.size() > max_queued) {
+        max_queued = worker_slots[i].queue.size();
+        victim = i;
+      }
     }
-
-    // Wait for them to finish.
-    for (std::thread& t : worker_threads) {
-      t.join();
+    if (victim >= 0) {
+      job = worker_slots[victim].queue.back();
+      worker_slots[victim].queue.pop_back();
     }
   }
-}
-
-void Grower::worker_thread_main(int thread_id) {
-  // These instances will be reused when processing the graphs.
-  Graph base;
-  int base_graph_id;
-  Graph copy;
-  Graph min_ratio_graph;
-  EdgeCandidates edge_candidates(Graph::N);
-
-  auto last_check_time = std::chrono::steady_clock::now();
-
-  while (true) {
-    // The lock scope to safely get a graph from the queue.
+  if (job == nullptr && coordinator_client != nullptr && !worker_done) {
+    // Take a new base graph from the coordinator, before splitting the ones being processed. The
+    // request waits for the socket, so it's made without holding the lock.
+    lock.unlock();
+    int base_graph_id;
+    CoordinatorClient::Reply reply;
     {
-      std::scoped_lock lock(queue_mutex);
-      if (to_be_processed.empty()) return;
-      base = to_be_processed.front();
-      base_graph_id = to_be_processed_id++;
-      to_be_processed.pop();
-      Counters::increment_growth_processed_graphs_in_current_step();
+      std::scoped_lock coordinator_lock(coordinator_mutex);
+      reply = coordinator_client->request_job(base_graph_id);
     }
-
-    Fraction min_ratio = Fraction::infinity();
-    if (search_ratio_graph) {
-      // If we are searching all graphs generating the given ratio value, set min_ratio
-      // to be slightly higher than the given value so that the min_ratio optimization
-      // won't skip any graph that produces the ratio value.
-      min_ratio = ratio_to_search + Fraction::epsilon();
+    lock.lock();
+    if (reply == CoordinatorClient::Reply::JOB && base_graph_id >= 0 &&
+        base_graph_id < base_graph_count) {
+      job = &jobs.emplace_back(base_graph_id, worker_base_graphs[base_graph_id]);
+    } else if (reply != CoordinatorClient::Reply::WAIT) {
+      worker_done = true;
     }
+  }
 
-    uint64 graphs_processed = 0;
-    EdgeGenerator edge_gen(edge_candidates, base);
-    while (edge_gen.next(copy, true, min_ratio)) {
-      // Thread 0 has the extra responsibility as time keeper,
-      // to periodically ask Counters to print.
-      if (thread_id == 0) {
-        if (edge_gen.stats_edge_sets % stats_check_every_n_gen == 0) {
-          const auto now = std::chrono::steady_clock::now();
-          int seconds =
-              std::chrono::duration_cast<std::chrono::seconds>(now - last_check_time).count();
-          if (seconds >= stats_print_every_n_seconds) {
-            std::scoped_lock lock(counters_mutex);
-            last_check_time = now;
-            Counters::observe_ratio(min_ratio_graph, get_ratio(min_ratio_graph), graphs_processed);
-            Counters::observe_edgegen_stats(edge_gen.stats_tk_skip, edge_gen.stats_tk_skip_bits,
-                                            edge_gen.stats_theta_edges_skip,
-                                            edge_gen.stats_theta_directed_edges_skip,
-                                            edge_gen.stats_edge_sets);
-            edge_gen.clear_stats();
-            Counters::print_at_time_interval();
-            if (log != nullptr) {
-              edge_gen.print_debug(std::cout, false, base_graph_id);
-              edge_gen.print_debug(*log, false, base_graph_id);
-            }
-          }
+  if (job != nullptr && !job->resumed_ranges.empty()) {
+    // Continue one of the ranges saved in the checkpoint.
+    progress = std::move(job->resumed_ranges.back());
+    job->resumed_ranges.pop_back();
+  } else if (job != nullptr) {
+    progress = RangeProgress();
+    progress.end = EdgeGenerator::get_prefix_count(prefix_digits);
+    Counters::increment_growth_processed_graphs_in_current_step();
+  } else {
+    // No base graph is queued, try to steal half of the remaining range from the busiest thread.
+    while (true) {
+      int victim = -1;
+      uint32 max_remaining = 0;
+      for (int i = 0; i < num_worker_threads; i++) {
+        if (i != thread_id && worker_slots[i].range != nullptr &&
+            worker_slots[i].range->remaining() > max_remaining) {
+          max_remaining = worker_slots[i].range->remaining();
+          victim = i;
         }
       }
+      if (victim < 0) return false;
+
+      WorkerSlot& victim_slot = worker_slots[victim];
+      uint32 stolen_begin, stolen_end;
+      // The victim may have entered the last prefixes since we looked, in which case we simply
+      // try again.
+      if (!victim_slot.range->steal_half(stolen_begin, stolen_end)) continue;
+      // The victim can't complete the job while we hold the lock, so it's safe to register the
+      // new range with the job here.
+      job = victim_slot.job;
+      job->pending_ranges++;
+      victim_slot.progress.end = stolen_begin;
+      progress = RangeProgress();
+      progress.begin = stolen_begin;
+      progress.end = stolen_end;
+      break;
+    }
+  }
+  range = std::make_unique<EnumRange>(progress.begin, progress.end);
+  if (progress.started) range->enter(progress.current);
+  own_slot.job = job;
+  own_slot.range = range.get();
+  return true;
+}
 
-      if (contains_forbidden_subgraph(copy, Graph::N - 1)) {
-        edge_gen.notify_contain_tk_skip();
-        continue;
-      }
+void GrowerBase::write_log_record(const LogRecord& record) const {
+  if (record.type == LogRecord::Type::BASE_GRAPH_RESULT) {
+    *log_detail << "---- G[" << record.base_graph_id << "] T[" << record.thread_id
+                << "]: min_ratio = " << record.ratio.to_string() << " :\n  ";
+    record.base.print_concise(*log_detail, true);
+    *log_detail << "  ";
+    record.graph.print_concise(*log_detail, true);
+  } else if (record.type == LogRecord::Type::BASE_GRAPH_PERF) {
+    const BaseGraphPerf& perf = record.perf;
+    std::ostringstream threads;
+    for (size_t i = 0; i < perf.threads.size(); i++) {
+      threads << (i == 0 ? "" : ",") << perf.threads[i];
+    }
+    // The edge sets leave out the states skipped inside the edge generator, so the throughput is
+    // measured in enumeration states.
+    const double enum_states_per_second =
+        perf.thread_seconds > 0 ? perf.enum_states / perf.thread_seconds : 0;
+    *log_perf << "{\"base_graph_id\":" << record.base_graph_id << ",\"threads\":["
+              << threads.str() << "],\"wall_seconds\":" << perf.wall_seconds
+              << ",\"thread_seconds\":" << perf.thread_seconds << ",\"min_ratio\":\""
+              << record.ratio.to_string() << "\",\"graphs\":" << perf.graphs
+              << ",\"edge_sets\":" << perf.edge_sets << ",\"enum_states\":" << perf.enum_states
+              << ",\"forbidden_tests\":" << perf.forbidden_tests
+              << ",\"tk_skip\":" << perf.tk_skip << ",\"tk_skip_bits\":" << perf.tk_skip_bits
+              << ",\"theta_edges_skip\":" << perf.theta_edges_skip
+              << ",\"theta_directed_edges_skip\":" << perf.theta_directed_edges_skip
+              << ",\"enum_states_per_second\":" << enum_states_per_second << "}\n";
+  } else {
+    const std::string to_print =
+        "G[" + std::to_string(record.base_graph_id) + "], base_ratio = " +
+        record.base_ratio.to_string() + ", grow_to_ratio = " + record.ratio.to_string() +
+        " :\n  " + record.base.serialize_edges() + "\n  " + record.graph.serialize_edges() + "\n";
+    std::cout << to_print;
+    if (log_result != nullptr) {
+      *log_result << to_print;
+    }
+  }
+}
 
-      // Bookkeeping: retain the minimum ratio value encountered so far, and the graph genreated it.
-      graphs_processed++;
-      if (!search_ratio_graph) {
-        // Normal path: we are searching for min_ratio.
-        if (get_ratio(copy) < min_ratio) {
-          min_ratio = get_ratio(copy);
-          min_ratio_graph = copy;
-        }
-      } else {
-        // Here we are searching for all graphs that produce the given ratio value.
-        if (get_ratio(copy) <= ratio_to_search) {
-          std::string to_print = "G[" + std::to_string(base_graph_id) +
-                                 "], base_ratio = " + get_ratio(base).to_string() +
-                                 ", grow_to_ratio = " + get_ratio(copy).to_string() + " :\n  " +
-                                 base.serialize_edges() + "\n  " + copy.serialize_edges() + "\n";
+void GrowerBase::flush_logs() const {
+  if (log_detail != nullptr) log_detail->flush();
+  if (log_result != nullptr) log_result->flush();
+  if (log_perf != nullptr) log_perf->flush();
+}
 
-          std::scoped_lock lock(counters_mutex);
-          std::cout << to_print;
-          if (log_result != nullptr) {
-            *log_result << to_print;
-          }
-          Counters::notify_ratio_graph_found(copy, get_ratio(copy));
-        }
-      }
+bool GrowerBase::wait_for_coordinator() {
+  {
+    std::scoped_lock lock(counters_mutex);
+    if (coordinator_client == nullptr || worker_done) return false;
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(WORKER_WAIT_MILLISECONDS));
+  return true;
+}
+
+std::string GrowerBase::get_search_key(const std::string& problem) const {
+  return "K=" + std::to_string(Graph::K) + " N=" + std::to_string(Graph::N) + " " + problem +
+         " base_graphs=" + std::to_string(base_graph_count) +
+         " order=" + std::to_string(static_cast<int>(candidate_order)) +
+         " min_degree=" + std::to_string(min_degree_filter) +
+         " orderly=" + std::to_string(orderly_generation) +
+         " search=" + (search_ratio_graph ? ratio_to_search.to_string() : std::string("min"));
+}
+
+void GrowerBase::coordinate_final_step(GraphSpan base_graphs,
+                                       const std::string& problem) {
+  base_graph_count = static_cast<int>(base_graphs.size());
+  int max_idx = base_graph_count;
+  if (end_idx > 0 && end_idx < max_idx) {
+    max_idx = end_idx + 1;
+  }
+  Coordinator coordinator;
+  if (!coordinator.listen(coordinator_address)) {
+    std::cout << "Can't listen at " << coordinator_address << "\n";
+    interrupted = true;
+    return;
+  }
+  Counters::enter_final_step(std::max(max_idx - start_idx, 0));
+  std::cout << "Waiting for the workers at " << coordinator_address << "\n";
+  auto on_result = [this, &base_graphs](const Coordinator::Result& r) {
+    const Graph& base = base_graphs[r.base_graph_id];
+    results.push_back(std::make_tuple(r.base_graph_id, base, r.min_ratio_graph));
+    Counters::increment_growth_processed_graphs_in_current_step();
+    Counters::observe_ratio(r.min_ratio_graph, r.min_ratio, 0);
+    if (log_detail != nullptr) {
+      *log_detail << "---- G[" << r.base_graph_id << "] W[" << r.worker_id
+                  << "]: min_ratio = " << r.min_ratio.to_string() << " :\n  ";
+      base.print_concise(*log_detail, true);
+      *log_detail << "  ";
+      r.min_ratio_graph.print_concise(*log_detail, true);
+      log_detail->flush();
     }
+  };
+  coordinator.serve(get_search_key(problem), start_idx, max_idx - 1, on_result);
+}
 
-    // The lock scope to add the min ratio to the global Counters.
-    {
-      std::scoped_lock lock(counters_mutex);
-      results.push_back(std::make_tuple(base_graph_id, base, min_ratio_graph));
-      Counters::observe_ratio(min_ratio_graph, get_ratio(min_ratio_graph), graphs_processed);
-      Counters::observe_edgegen_stats(
-          edge_gen.stats_tk_skip, edge_gen.stats_tk_skip_bits, edge_gen.stats_theta_edges_skip,
-          edge_gen.stats_theta_directed_edges_skip, edge_gen.stats_edge_sets);
-      if (log_detail != nullptr && !search_ratio_graph) {
-        *log_detail << "---- G[" << base_graph_id << "] T[" << thread_id
-                    << "]: min_ratio = " << min_ratio.to_string() << " :\n  ";
-        base.print_concise(*log_detail, true);
-        *log_detail << "  ";
-        min_ratio_graph.print_concise(*log_detail, true);
-        log_detail->flush();
-      }
+bool GrowerBase::save_progress(int thread_id, const EdgeGenerator& edge_gen,
+                               const EnumRange& range, Fraction min_ratio,
+                               const Graph& min_ratio_graph) {
+  WorkerSlot& slot = worker_slots[thread_id];
+  RangeProgress& progress = slot.progress;
+  progress.started = true;
+  progress.current = range.get_current();
+  edge_gen.save_state(progress.state);
+  progress.min_ratio = min_ratio;
+  progress.min_ratio_graph = min_ratio_graph;
+  if (stop_requested) {
+    // Nothing can be stolen from the range anymore.
+    slot.range = nullptr;
+    interrupted = true;
+    return true;
+  }
+  if (std::chrono::steady_clock::now() - last_checkpoint_time >=
+      std::chrono::seconds(checkpoint_interval_seconds)) {
+    write_checkpoint();
+  }
+  return false;
+}
+
+// The checkpoint is a text file. The first line is
+//   checkpoint prefix_digits search_key
+// followed by the line of the Counters of the final enumeration phase,
+//   stats <values of Counters::get_final_step_stats()>
+// the line of each completed base graph,
+//   result base_graph_id min_ratio_graph
+// and for each unfinished base graph with started ranges, the merged result of its completed
+// ranges followed by the progress of each started range:
+//   job base_graph_id min_ratio.n min_ratio.d min_ratio_range_begin min_ratio_graph
+//   range base_graph_id begin end current started done min_ratio.n min_ratio.d digit_count
+//       enum_state[0..digit_count-1] order[...] skip_count[...] min_ratio_graph
+// All on one line. The graphs are in the form of Graph::serialize_edges(), at the end of the line
+// since they contain spaces. The base graphs not mentioned are enumerated from the beginning.
+void GrowerBase::write_checkpoint() {
+  last_checkpoint_time = std::chrono::steady_clock::now();
+  // Group the ranges in the slots by their jobs.
+  std::unordered_map<const BaseGraphJob*, std::vector<const RangeProgress*>> job_ranges;
+  for (int i = 0; i < std::max(num_worker_threads, 1); i++) {
+    if (worker_slots[i].job != nullptr) {
+      job_ranges[worker_slots[i].job].push_back(&worker_slots[i].progress);
+    }
+  }
+
+  const std::string temp_path = checkpoint_path + ".tmp";
+  std::ofstream out(temp_path);
+  out << "checkpoint " << prefix_digits << " " << search_key << "\n";
+  out << "stats";
+  for (uint64 value : Counters::get_final_step_stats()) out << " " << value;
+  out << "\n";
+  for (const auto& r : results) {
+    out << "result " << std::get<0>(r) << " " << std::get<2>(r).serialize_edges() << "\n";
+  }
+  for (const BaseGraphJob& job : jobs) {
+    if (job.pending_ranges == 0) continue;
+    std::vector<const RangeProgress*> ranges = job_ranges[&job];
+    for (const RangeProgress& resumed : job.resumed_ranges) ranges.push_back(&resumed);
+    if (ranges.empty()) continue;
+    out << "job " << job.base_graph_id << " " << job.min_ratio.n << " " << job.min_ratio.d << " "
+        << job.min_ratio_range_begin << " " << job.min_ratio_graph.serialize_edges() << "\n";
+    for (const RangeProgress* p : ranges) {
+      const EdgeGenerator::SavedState& state = p->state;
+      out << "range " << job.base_graph_id << " " << p->begin << " " << p->end << " "
+          << p->current << " " << p->started << " " << state.done << " " << p->min_ratio.n << " "
+          << p->min_ratio.d << " " << state.enum_state.size();
+      for (uint8 digit : state.enum_state) out << " " << static_cast<int>(digit);
+      for (uint8 c : state.order) out << " " << static_cast<int>(c);
+      for (uint32 count : state.skip_count) out << " " << count;
+      out << " " << p->min_ratio_graph.serialize_edges() << "\n";
     }
   }
+  out.close();
+  if (!out || std::rename(temp_path.c_str(), checkpoint_path.c_str()) != 0) {
+    std::cout << "Failed to write the checkpoint " << checkpoint_path << "\n";
+  }
 }
 
-// Print the content of the collected graphs after the growth to console and log files.
-void Grower::print_before_final(const std::vector<Graph> collected_graphs[MAX_VERTICES]) const {
-  if (log != nullptr) {
-    print_state_to_stream(std::cout, collected_graphs);
-    print_state_to_stream(*log, collected_graphs);
-    log->flush();
+bool GrowerBase::read_checkpoint() {
+  std::ifstream in(checkpoint_path);
+  if (!in) {
+    std::cout << "No checkpoint " << checkpoint_path << " to resume from, starting over.\n";
+    return true;
+  }
+  std::string line, tag;
+  int digits;
+  std::string key;
+  if (!std::getline(in, line)) return false;
+  std::istringstream header(line);
+  if (!(header >> tag >> digits) || tag != "checkpoint" || !std::getline(header >> std::ws, key) ||
+      key != search_key) {
+    return false;
   }
-  if (log_detail != nullptr) {
-    for (int i = 0; i < Graph::N; i++) {
-      Fraction min_ratio = Fraction::infinity();
-      for (const Graph& g : collected_graphs[i]) {
-        min_ratio = std::min(min_ratio, get_ratio(g));
+  const int digit_count = EdgeCandidates(Graph::N).edge_candidate_count;
+  if (digits < 0 || digits >= digit_count) return false;
+  prefix_digits = digits;
+  const uint32 prefix_count = EdgeGenerator::get_prefix_count(prefix_digits);
+
+  // Returns the job of the given base graph id, or nullptr if it's out of the range between
+  // start_idx and end_idx of this run.
+  auto find_job = [this](int id) -> BaseGraphJob* {
+    if (jobs.empty() || id < jobs.front().base_graph_id || id > jobs.back().base_graph_id) {
+      return nullptr;
+    }
+    return &jobs[id - jobs.front().base_graph_id];
+  };
+  // Reads the graph at the end of the line.
+  auto read_graph = [](std::istringstream& fields, Graph& g) {
+    std::string text;
+    return std::getline(fields >> std::ws, text) && Graph::parse_edges(text, g);
+  };
+
+  while (std::getline(in, line)) {
+    std::istringstream fields(line);
+    int id;
+    Graph g;
+    fields >> tag;
+    if (tag == "stats") {
+      std::vector<uint64> stats(Counters::get_final_step_stats().size());
+      for (uint64& value : stats) fields >> value;
+      if (!fields) return false;
+      Counters::restore_final_step_stats(stats);
+    } else if (tag == "result") {
+      if (!(fields >> id) || !read_graph(fields, g)) return false;
+      BaseGraphJob* job = find_job(id);
+      if (job == nullptr) continue;
+      job->pending_ranges = 0;
+      results.push_back(std::make_tuple(id, job->base, g));
+      Counters::increment_growth_processed_graphs_in_current_step();
+    } else if (tag == "job") {
+      int ratio_n, ratio_d;
+      uint32 range_begin;
+      if (!(fields >> id >> ratio_n >> ratio_d >> range_begin) || ratio_d <= 0 ||
+          !read_graph(fields, g)) {
+        return false;
       }
-
-      *log_detail << "-------- Accumulated canonicals[order=" << i
-                  << "] : count = " << collected_graphs[i].size()
-                  << ", min_ratio = " << min_ratio.to_string() << " --------\n";
-      int idx = 0;
-      for (const Graph& g : collected_graphs[i]) {
-        *log_detail << "  [" << idx++ << "] ";
-        g.print_concise(*log_detail, true);
+      BaseGraphJob* job = find_job(id);
+      if (job == nullptr) continue;
+      job->min_ratio = Fraction(ratio_n, ratio_d);
+      job->min_ratio_graph = g;
+      job->min_ratio_range_begin = range_begin;
+      Counters::increment_growth_processed_graphs_in_current_step();
+    } else if (tag == "range") {
+      RangeProgress p;
+      EdgeGenerator::SavedState& state = p.state;
+      int ratio_n, ratio_d, size;
+      if (!(fields >> id >> p.begin >> p.end >> p.current >> p.started >> state.done >> ratio_n >>
+            ratio_d >> size) ||
+          size != (p.started ? digit_count : 0) || ratio_d <= 0 || p.begin >= p.end ||
+          p.end > prefix_count || p.current < p.begin || p.current >= p.end) {
+        return false;
+      }
+      p.min_ratio = Fraction(ratio_n, ratio_d);
+      state.enum_state.resize(size);
+      state.order.resize(size);
+      state.skip_count.resize(size);
+      for (uint8& digit : state.enum_state) {
+        int value;
+        fields >> value;
+        if (value < 0 || value > Graph::K + 1) return false;
+        digit = static_cast<uint8>(value);
+      }
+      for (uint8& c : state.order) {
+        int value;
+        fields >> value;
+        if (value < 0 || value >= size) return false;
+        c = static_cast<uint8>(value);
       }
+      for (uint32& skips : state.skip_count) fields >> skips;
+      if (!fields || !read_graph(fields, p.min_ratio_graph)) return false;
+      BaseGraphJob* job = find_job(id);
+      if (job == nullptr) continue;
+      job->resumed_ranges.push_back(std::move(p));
+    } else {
+      return false;
     }
-    log_detail->flush();
   }
+  for (BaseGraphJob& job : jobs) {
+    if (!job.resumed_ranges.empty()) job.pending_ranges = job.resumed_ranges.size();
+  }
+  return true;
 }
-void Grower::print_state_to_stream(std::ostream& os,
-                                   const std::vector<Graph> collected_graphs[MAX_VERTICES]) const {
+
+void GrowerBase::print_state_to_stream(std::ostream& os,
+                                       const GraphSpan collected_graphs[MAX_VERTICES]) const {
   os << "\n---------------------------------\n"
      << "Growth phase completed. State:\n";
   for (int i = 0; i < Graph::N; i++) {
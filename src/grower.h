@@ -1,18 +1,28 @@
 #pragma once
 
+#include "async_logger.h"
+#include "coordinator.h"
+#include "counters.h"
+#include "cpu_topology.h"
 #include "edge_gen.h"
 #include "graph.h"
+#include "growth_snapshot.h"
+#include "growth_spill.h"
 
-// Grow set of non-isomorphic graphs from empty graph, by adding one vertex at a time.
-class Grower {
- private:
+// The part of Grower that doesn't depend on the problem being searched: the options, the logging,
+// and the work scheduling of the final enumeration phase. See `Grower` below.
+class GrowerBase {
+ protected:
   // The number of worker threads to use in the final enumeration step.
   const int num_worker_threads;
   // If true, stop after the growing phase but don't perform the final enumeration phase.
   const bool skip_final_enum;
-  // If true, the min_theta optimization is enabled.
+  // If true, the min_theta optimization is enabled: the final enumeration phase skips the edge
+  // sets whose ratio bound is above the min ratio found so far.
   const bool use_min_theta_opt;
-  // If true, the contains T_k optimization is enabled.
+  // If true, the contains T_k optimization is enabled: if T_k is forbidden, the final
+  // enumeration phase filters out the graphs containing T_k inside the edge generator, see
+  // `EdgeGenerator::set_Tk_filter()`.
   const bool use_contains_Tk_opt;
   // The start index and end index in the final enumeration phase.
   const int start_idx;
@@ -23,15 +33,488 @@ class Grower {
   // The ratio value to search for. Ignored unless search_ratio_graph==true.
   const Fraction ratio_to_search;
 
-  // The number of generations between checking whether should print statistics.
-  uint64 stats_check_every_n_gen = 100000;
-  // The number of seconds between printing statistics in the final enumeration step.
+  // The order of the edge candidates in the final enumeration phase.
+  CandidateOrder candidate_order = CandidateOrder::ASCENDING;
+
+  // If true, the final enumeration phase only generates the graphs where the new vertex has the
+  // minimum degree, see `EdgeGenerator::set_min_degree_filter()`.
+  bool min_degree_filter = false;
+
+  // If positive, the final enumeration phase is replaced by estimating the cost of each base
+  // graph with this number of random probes, see `estimate_final_step()`.
+  int estimate_probes = 0;
+
+  // If positive, the final enumeration phase processes the base graphs in the descending order of
+  // their search tree sizes, estimated with this number of random probes each.
+  int longest_first_probes = 0;
+
+  // The number of seconds between printing statistics in the final enumeration step, see
+  // `monitor_thread_main()`.
   int stats_print_every_n_seconds = 20;
 
+  // If not empty, the final enumeration phase saves its progress into this file, see
+  // `set_checkpoint()`.
+  std::string checkpoint_path;
+  // The number of seconds between the periodic checkpoints.
+  int checkpoint_interval_seconds = 600;
+  // If true, the final enumeration phase continues from the checkpoint file if it exists.
+  bool resume_from_checkpoint = false;
+  // The time of the last checkpoint. Protected by counters_mutex.
+  std::chrono::time_point<std::chrono::steady_clock> last_checkpoint_time;
+  // The key of the search in the final enumeration phase, see `get_search_key()`. A checkpoint
+  // is only resumed by the same search.
+  std::string search_key;
+  // True if the final enumeration phase didn't complete, see `is_interrupted()`.
+  bool interrupted = false;
+  // Set by request_stop().
+  static std::atomic<bool> stop_requested;
+  // When checkpointing, the number of seconds between saving the progress of each range into
+  // the worker's slot. The monitor thread requests the saves, and the workers check for the
+  // request after each batch.
+  static constexpr int SAVE_PROGRESS_EVERY_N_SECONDS = 1;
+  // The shortest time the monitor thread sleeps between its checks.
+  static constexpr int MONITOR_MIN_SLEEP_MILLISECONDS = 10;
+
+  // If not empty, the directory of the growth snapshots, see `set_growth_snapshot()`.
+  std::string growth_snapshot_dir;
+
+  // If true, the growth phase uses orderly generation, see `set_orderly_generation()`.
+  bool orderly_generation = false;
+
+  // If not empty, the directory to spill the growth steps into, see `set_growth_spill()`.
+  std::string growth_spill_dir;
+  uint64 growth_memory_budget = 0;
+
+  // If not empty, the address of the coordinator to run as, or to take the base graphs from as a
+  // worker, see `set_coordinator()` and `set_worker()`.
+  std::string coordinator_address;
+  bool is_coordinator = false;
+  // The connection to the coordinator as a worker. Its requests are serialized by
+  // coordinator_mutex, and made without holding counters_mutex, so that the other worker threads
+  // don't wait for the socket.
+  std::unique_ptr<CoordinatorClient> coordinator_client;
+  std::mutex coordinator_mutex;
+  // The base graphs of the ids handed out by the coordinator.
+  GraphSpan worker_base_graphs;
+  // True if the coordinator has no more ids to hand out. Protected by counters_mutex.
+  bool worker_done = false;
+  // The number of milliseconds an idle worker thread waits before asking the coordinator again.
+  static constexpr int WORKER_WAIT_MILLISECONDS = 100;
+
+  // How the worker threads are placed on the CPUs, see `set_placement()`.
+  PlacementPolicy placement = PlacementPolicy::NONE;
+  // The CPU of each worker thread, or empty if they are not pinned.
+  std::vector<int> worker_cpus;
+
   // The log files.
   std::ostream* log;
   std::ostream* log_detail;
   std::ostream* log_result;
+  std::ostream* log_perf = nullptr;
+
+  // The work done on a base graph in the final enumeration phase, summed over its ranges, which
+  // is written into the perf log when the base graph completes. Only covers the work of this
+  // run, not the work before a checkpoint it resumed from.
+  struct BaseGraphPerf {
+    // The worker threads that completed the ranges, in the order of completion.
+    std::vector<int> threads;
+    // The start time of the first range.
+    std::chrono::time_point<std::chrono::steady_clock> start_time;
+    bool started = false;
+    // The seconds from the start of the first range to the end of the last one.
+    double wall_seconds = 0;
+    // The sum of the seconds of the ranges.
+    double thread_seconds = 0;
+    // The graphs without the forbidden subgraph.
+    uint64 graphs = 0;
+    // The forbidden subgraph tests, by the worker threads and by the edge generator.
+    uint64 forbidden_tests = 0;
+    // The edge generator stats, see `EdgeGenerator`.
+    uint64 edge_sets = 0;
+    uint64 enum_states = 0;
+    uint64 tk_skip = 0;
+    uint64 tk_skip_bits = 0;
+    uint64 theta_edges_skip = 0;
+    uint64 theta_directed_edges_skip = 0;
+  };
+
+  // A line of the detail log, the result log or the perf log written by the worker threads of the
+  // final enumeration phase, see `logger`.
+  struct LogRecord {
+    enum class Type {
+      // The min ratio graph of a base graph, written into the detail log.
+      BASE_GRAPH_RESULT,
+      // A graph of the ratio being searched for, written into the console and the result log.
+      RATIO_GRAPH_FOUND,
+      // The perf of a base graph, written into the perf log.
+      BASE_GRAPH_PERF,
+    };
+    Type type;
+    int base_graph_id;
+    int thread_id;
+    // The min ratio of the base graph, or the ratio of the found graph.
+    Fraction ratio = Fraction::infinity();
+    // The ratio of the base graph, for RATIO_GRAPH_FOUND only.
+    Fraction base_ratio = Fraction::infinity();
+    Graph base;
+    // The min ratio graph, or the found graph.
+    Graph graph;
+    // For BASE_GRAPH_PERF only.
+    BaseGraphPerf perf;
+  };
+  // Writes the log records of the worker threads, during the final enumeration phase.
+  std::unique_ptr<AsyncLogger<LogRecord>> logger;
+
+  // Formats the record into its log, see `logger`.
+  void write_log_record(const LogRecord& record) const;
+  // Flushes the logs written by write_log_record().
+  void flush_logs() const;
+
+  // Prints the content of the canonicals after the growth to console and log files.
+  void print_state_to_stream(std::ostream& os,
+                             const GraphSpan collected_graphs[MAX_VERTICES]) const;
+
+  // The progress of one prefix range of a base graph, as saved in the checkpoints.
+  struct RangeProgress {
+    uint32 begin = 0;
+    uint32 end = 0;
+    // The prefix being enumerated, see `EnumRange`.
+    uint32 current = 0;
+    // False if the enumeration of the range hasn't started, in which case the members below are
+    // not used.
+    bool started = false;
+    EdgeGenerator::SavedState state;
+    Fraction min_ratio = Fraction::infinity();
+    Graph min_ratio_graph;
+  };
+
+  // The state of one base graph in the final enumeration phase.
+  //
+  // The enumeration of a base graph can be split into several prefix ranges (see `EnumRange`),
+  // processed by different worker threads. Each range finds the first graph with its smallest
+  // ratio in enumeration order, and the ranges are merged such that the result is exactly what a
+  // single thread enumerating the whole base graph would produce: the smallest ratio wins, and
+  // among equal ratios, the range that comes first in enumeration order wins.
+  struct BaseGraphJob {
+    // Id of the base graph.
+    const int base_graph_id;
+    // The base graph.
+    const Graph base;
+    // Number of ranges of this base graph that are not completed yet. The job is completed when
+    // the count drops to 0.
+    std::atomic<int> pending_ranges;
+    // The smallest ratio found among all ranges so far, packed as (numerator << 32) | denominator.
+    // Shared by the ranges to tighten the min_theta optimization.
+    std::atomic<uint64> shared_min_ratio;
+
+    // Merged results of the completed ranges. Protected by counters_mutex.
+    Fraction min_ratio;
+    Graph min_ratio_graph;
+    uint32 min_ratio_range_begin;
+    // The unfinished ranges restored from a checkpoint, which are queued for the worker threads
+    // instead of the full range. Protected by counters_mutex.
+    std::vector<RangeProgress> resumed_ranges;
+    // The work done on the base graph so far. Protected by counters_mutex.
+    BaseGraphPerf perf;
+
+    BaseGraphJob(int base_graph_id_, const Graph& base_);
+  };
+
+  // Information about the work a worker thread is doing, so that idle threads can steal from it.
+  // Protected by counters_mutex, so that a checkpoint sees each range exactly once, either in a
+  // slot or merged into its job. The EnumRange itself is thread safe.
+  struct WorkerSlot {
+    BaseGraphJob* job = nullptr;
+    EnumRange* range = nullptr;
+    // The progress of the range as of its last save, only saved when checkpointing. The stolen
+    // prefixes are removed from it right away.
+    RangeProgress progress;
+    // The base graphs waiting to be processed by this worker. The worker takes them from the
+    // front, and the other workers steal them from the back when their own queues are empty. A
+    // base graph resumed from a checkpoint is queued once for each of its resumed ranges.
+    std::deque<BaseGraphJob*> queue;
+  };
+
+  // The statistics a worker thread publishes after each batch of the final enumeration phase, read
+  // by the monitor thread without locks. Each worker is the only writer of the counters in its
+  // slot, and each slot has its own cache line, so publishing is a few relaxed stores.
+  struct alignas(64) WorkerStats {
+    // The id of the base graph being processed, or -1 if the worker is idle.
+    std::atomic<int> base_graph_id{-1};
+    // The graphs returned by the edge generator so far.
+    std::atomic<uint64> graphs_generated{0};
+    // The graphs without the forbidden subgraph among them.
+    std::atomic<uint64> graphs_processed{0};
+    // Set by the monitor thread when the worker should save the progress of its range, see
+    // SAVE_PROGRESS_EVERY_N_SECONDS.
+    std::atomic<bool> save_requested{false};
+
+    // Adds to one of the counters. Only called by the worker owning the slot.
+    static void add(std::atomic<uint64>& counter, uint64 delta) {
+      counter.store(counter.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+    }
+  };
+
+  // Packs a Fraction into an integer, so that it can be stored in a std::atomic.
+  static uint64 pack_fraction(Fraction f) {
+    return (static_cast<uint64>(f.n) << 32) | static_cast<uint32>(f.d);
+  }
+  static Fraction unpack_fraction(uint64 packed) {
+    return Fraction(static_cast<int>(packed >> 32), static_cast<int>(packed & 0xFFFFFFFF));
+  }
+
+  // Creates the jobs of the base graphs between start_idx and end_idx for the final enumeration
+  // phase, and decides how to split them into prefix ranges among the worker threads.
+  void prepare_final_step(GraphSpan base_graphs);
+
+  // Deals the jobs to the queues of the worker threads in turn. If `costs` is not empty, costs[i]
+  // is the estimated cost of jobs[i], and the jobs are dealt in the descending order of the
+  // costs, so that the expensive ones start first. Otherwise they are dealt in the order of ids.
+  void schedule_jobs(const std::vector<double>& costs);
+
+  // Gets the next piece of work for the given worker thread: either a new base graph from its own
+  // queue, stolen from the longest queue of the other workers or handed out by the coordinator,
+  // with its full prefix range, or the upper half of the range of the busiest worker. Publishes
+  // the work in the worker's slot. Returns false if there is nothing left to do for now.
+  bool acquire_work(int thread_id, BaseGraphJob*& job, std::unique_ptr<EnumRange>& range);
+
+  // Called when acquire_work() returns false. As a worker, waits a while and returns true if the
+  // coordinator may still hand out ids, such as the ones of a dead worker. Returns false
+  // otherwise.
+  bool wait_for_coordinator();
+
+  // Returns the key of the search, which the workers must share with the coordinator, and a
+  // resumed run with its checkpoint: K, N, the problem, the number of base graphs, and the
+  // options changing the base graphs or the result of each base graph.
+  std::string get_search_key(const std::string& problem) const;
+
+  // Runs as the coordinator in place of the final enumeration phase: hands out the ids of the
+  // base graphs between start_idx and end_idx to the worker processes, and collects their
+  // results, see `Coordinator`.
+  void coordinate_final_step(GraphSpan base_graphs, const std::string& problem);
+
+  // Called by a worker thread between two batches when checkpointing, holding counters_mutex,
+  // after adding the stats of its range to Counters: saves the progress of the range into the
+  // worker's slot, and writes a checkpoint if it's time to. Returns true if the worker should
+  // stop, in which case the range is left in the slot for the final checkpoint.
+  bool save_progress(int thread_id, const EdgeGenerator& edge_gen, const EnumRange& range,
+                     Fraction min_ratio, const Graph& min_ratio_graph);
+
+  // Writes the results of the completed base graphs, the merged results and the ranges of the
+  // unfinished ones, and the Counters of the final enumeration phase into the checkpoint file.
+  // The file is replaced atomically. Must hold counters_mutex, unless the workers are done.
+  void write_checkpoint();
+
+  // Called after prepare_final_step(): restores the results, the unfinished ranges, the prefix
+  // digits and the Counters from the checkpoint file, if it exists. Returns false if the
+  // checkpoint is invalid or from a different search.
+  bool read_checkpoint();
+
+  // The mutex to protect the counters and results under multi-threading.
+  std::mutex counters_mutex;
+  // The base graphs to be processed in the final enumeration phase, in the order of ids. The
+  // worker threads take them from the queues in their slots.
+  std::deque<BaseGraphJob> jobs;
+  // The slots of all worker threads.
+  std::unique_ptr<WorkerSlot[]> worker_slots;
+  // The published statistics of all worker threads.
+  std::unique_ptr<WorkerStats[]> worker_stats;
+  // Set to stop the monitor thread, which waits on monitor_cv. Protected by monitor_mutex.
+  bool monitor_stop = false;
+  std::mutex monitor_mutex;
+  std::condition_variable monitor_cv;
+
+  // The entry point of the monitor thread of the final enumeration phase. Every
+  // stats_print_every_n_seconds seconds, it sums the statistics published by the workers, and
+  // prints the progress and the rates since the last print. When checkpointing, it also requests
+  // the workers to save their progress. It runs until monitor_stop is set.
+  void monitor_thread_main();
+  // Number of highest enumeration state digits used as the prefix to split a base graph into
+  // ranges. 0 means base graphs are not split.
+  int prefix_digits;
+  // The number of base graphs in the final enumeration phase, including the ones out of the
+  // range between start_idx and end_idx.
+  int base_graph_count;
+  // The results of the final enumeration step.
+  // Values: 3-tuple (
+  //    id of the graph,
+  //    the base graph,
+  //    the graph with the minimum ratio among all graphs generated from the base graph).
+  std::vector<std::tuple<int, Graph, Graph>> results;
+  // The results of estimate_final_step().
+  // Values: 3-tuple (
+  //    id of the graph,
+  //    the estimated number of nodes in the search tree,
+  //    the half width of the 95% confidence interval of the estimate).
+  std::vector<std::tuple<int, double, double>> estimates;
+
+ public:
+  // Constructs the Grower object.
+  // log_stream is used for status reporting and debugging purpose.
+  GrowerBase(int num_worker_threads_, bool skip_final_enum_, bool use_min_theta_opt_,
+             bool use_contains_Tk_opt_, int start_idx_, int end_idx_,
+             bool search_ratio_graph_ = false, Fraction ratio_to_search_ = Fraction(1, 1));
+
+  // Sets the logging streams.
+  // If `details_per_graph` is true, print the min ratio value from each base graph into
+  // the details log.
+  // If `perf` is not nullptr, the final enumeration phase writes a JSON line with the work done
+  // on each base graph into it: the worker threads, the wall and thread seconds, the graph, edge
+  // set and enumeration state counts, the forbidden subgraph tests and the skips of the edge
+  // generator, and the enumeration states per thread second.
+  void set_logging(std::ostream* summary, std::ostream* detail, std::ostream* result,
+                   std::ostream* perf = nullptr);
+
+  // Returns the growth results.
+  const std::vector<std::tuple<int, Graph, Graph>>& get_results() const { return results; }
+
+  // Returns the estimates, if the final enumeration is replaced by estimation.
+  const std::vector<std::tuple<int, double, double>>& get_estimates() const { return estimates; }
+
+  // For debugging and testing purpose: override the number of seconds between printing stats.
+  void set_stats_print_interval(int print_every_n_seconds);
+
+  // Sets the order of the edge candidates used in the final enumeration phase.
+  // See `CandidateOrder` for details.
+  void set_candidate_order(CandidateOrder order) { candidate_order = order; }
+
+  // Sets whether the final enumeration phase only generates the graphs where the new vertex has
+  // the minimum degree. This finds the same min ratio with less work, but the min ratio of each
+  // base graph may be larger, since some of its graphs are only generated from other base graphs.
+  void set_min_degree_filter(bool enabled) { min_degree_filter = enabled; }
+
+  // Replaces the final enumeration phase by estimating the cost of each base graph with the given
+  // number of random probes. See `estimate_final_step()` for details.
+  void set_estimate_probes(int probes) { estimate_probes = probes; }
+
+  // Sets the number of random probes to estimate the cost of each base graph, so that the final
+  // enumeration phase starts the expensive base graphs first, leaving the cheap ones to balance
+  // the load at the end. 0 (default) processes the base graphs in the order of ids. The results
+  // are the same, but the min ratio graph reported by Counters may be a different one with the
+  // same ratio.
+  void set_longest_first(int probes) { longest_first_probes = probes; }
+
+  // Saves the progress of the final enumeration phase into the given file every
+  // `interval_seconds` seconds, and when the phase completes or stops (see `request_stop()`).
+  // The progress is the results of the completed base graphs, and for the unfinished ones the
+  // enumeration state and the min ratio graph of each range, which its worker thread saves
+  // every SAVE_PROGRESS_EVERY_N_SECONDS seconds.
+  //
+  // If `resume` is true and the file exists, the final enumeration phase continues from it, so
+  // only the work after the saved states is done again. The checkpoint must be from the same
+  // search (K, N and the candidate order), and the resumed run keeps its prefix ranges.
+  void set_checkpoint(const std::string& path, int interval_seconds, bool resume);
+
+  // Runs as the coordinator listening at the given address (see `Coordinator`): instead of the
+  // final enumeration, hands out the base graphs between start_idx and end_idx to the worker
+  // processes on demand, handing out again the ones of the workers that die, until the results of
+  // all of them are received. The results and logs are the same as the ones of the final
+  // enumeration, except that the min ratio graphs of the ties may be different with multiple
+  // worker threads.
+  void set_coordinator(const std::string& address) {
+    coordinator_address = address;
+    is_coordinator = true;
+  }
+
+  // Runs as a worker of the coordinator at the given address: the final enumeration phase
+  // processes the base graphs handed out by the coordinator, with all worker threads, and sends
+  // the result of each one back. start_idx and end_idx are ignored.
+  void set_worker(const std::string& address) {
+    coordinator_address = address;
+    is_coordinator = false;
+  }
+
+  // Reuses the graphs collected by the growth phase across runs, through the snapshot files in the
+  // given directory (see `GrowthSnapshot`). The growth phase starts from the levels in the file of
+  // the same problem and K with the most usable levels, and writes the file of the current N if
+  // it grew any level. The results are the same as without the snapshot.
+  void set_growth_snapshot(const std::string& dir) { growth_snapshot_dir = dir; }
+
+  // Sets whether the growth phase uses McKay's orderly generation (canonical augmentation)
+  // instead of deduplicating all extensions through a hash set: an extension of a graph is only
+  // kept if the new vertex is in the canonical deletion orbit (see
+  // `Graph::is_canonical_augmentation()`), so each isomorphism class is generated from exactly
+  // one graph of the previous step, and only the isomorphic extensions of the same graph need to
+  // be deduplicated. The graphs of the previous step are extended by the worker threads in
+  // parallel. The collected graphs are one per isomorphism class as before, but the
+  // representatives, and so the graph ids, are different ones. Not needed with spilling.
+  // Every class is only reached if deleting a vertex keeps a graph free of the forbidden
+  // subgraph, so if the policy's property is not monotone, grow() falls back to the hash set.
+  void set_orderly_generation(bool enabled) { orderly_generation = enabled; }
+
+  // Deduplicates the graphs of each growth step through the partition files in the given
+  // directory, holding at most about `memory_budget_bytes` of candidate graphs in memory while
+  // collecting and deduplicating them, instead of all the graphs of the step (see `GrowthSpill`).
+  // The deduplicated level itself is still kept in memory. The partitions are deduplicated with
+  // the worker threads, which share the budget. The collected graphs, and so the results, are the
+  // same as without spilling.
+  void set_growth_spill(const std::string& dir, uint64 memory_budget_bytes) {
+    growth_spill_dir = dir;
+    growth_memory_budget = memory_budget_bytes;
+  }
+
+  // Sets how the worker threads of the final enumeration phase are placed on the CPUs (see
+  // `PlacementPolicy`). Each worker thread pins itself before allocating its edge candidates and
+  // edge generators, so that they are allocated on its own NUMA node. The results are the same.
+  void set_placement(PlacementPolicy policy) { placement = policy; }
+
+  // Asks the final enumeration phase to stop: each worker thread saves its progress after its
+  // current batch and exits, then the final checkpoint is written. In the growth phase, grow()
+  // stops before the next number of vertices without writing a checkpoint. Only effective with
+  // set_checkpoint(). Safe to call from a signal handler or another thread.
+  static void request_stop() { stop_requested = true; }
+  // Cancels request_stop(), for testing purpose.
+  static void clear_stop_request() { stop_requested = false; }
+
+  // Returns true if the final enumeration phase didn't complete, either stopped by
+  // request_stop() or because the checkpoint to resume from doesn't match the search. The
+  // results are then incomplete.
+  bool is_interrupted() const { return interrupted; }
+};
+
+// The defaults of the optional functions of a Grower policy, see `Grower`.
+struct GrowerPolicy {
+  // Returns true if the forbidden property is monotone under edge supersets, namely adding edges
+  // to a graph containing the forbidden subgraph always gives a graph containing it. This holds
+  // for all "F is a subgraph" properties. If false, each graph is checked on its own, without
+  // skipping the supersets or only searching around the changed edge.
+  bool forbidden_is_monotone() const { return true; }
+
+  // Returns true if the forbidden subgraph is T_k, in which case the final enumeration lets
+  // the EdgeGenerator filter out the graphs containing T_k, see `EdgeGenerator::set_Tk_filter`.
+  bool forbids_Tk() const { return false; }
+};
+
+// Grow set of non-isomorphic graphs from empty graph, by adding one vertex at a time.
+//
+// The problem to search is given by the Policy, which derives from `GrowerPolicy` and defines:
+//
+//   // Returns the ratio of the given graph to minimize in the search, which may be theta_ratio,
+//   // zeta_ratio, etc.
+//   Fraction get_ratio(const Graph& g) const;
+//
+//   // Returns the lower bound function of get_ratio(), see `RatioBoundFn`, which is used to skip
+//   // the graphs that can't have a smaller ratio in the final enumeration phase.
+//   RatioBoundFn get_ratio_bound() const;
+//
+//   // Returns the name of the problem, which must be different for each problem and usable in
+//   // file names. It identifies the growth snapshots, see `set_growth_snapshot()`.
+//   std::string get_problem_name() const;
+//
+//   // Returns true if g contains a forbidden subgraph, which has v as a vertex.
+//   bool contains_forbidden_subgraph(Graph& g, int v) const;
+//
+//   // Returns true if g contains a forbidden subgraph which has the given edge (vertex set),
+//   // given that g without the edge doesn't contain one (see `EdgeGenerator::get_changed_edge()`).
+//   bool contains_forbidden_subgraph_with_edge(Graph& g, uint16 edge) const;
+//
+// and may redefine the functions of `GrowerPolicy`. The search loops are instantiated for each
+// policy, so these calls are inlined into the loops over the generated graphs.
+template <typename Policy>
+class Grower : public GrowerBase {
+ private:
+  // The problem to search.
+  Policy policy;
 
   // Returns a collection of graphs with n vertices that are T_k-free, one in each
   // isomorphism class. Note all edges added in this step contains vertex (n-1).
@@ -39,67 +522,787 @@ class Grower {
   // with (n-1) vertices.
   //
   // This function is called repeatedly to grow all graphs up to N-1 vertices.
-  std::vector<Graph> grow_step(int n, const std::vector<Graph>&);
+  std::vector<Graph> grow_step(int n, GraphSpan);
+
+  // The same as grow_step(), with orderly generation, see `set_orderly_generation()`.
+  std::vector<Graph> grow_step_orderly(int n, GraphSpan base_graphs);
 
   // Enumerates all graphs in the final step where all graphs have N vertices.
   // We don't need to collect any graph in this step.
   // The parameter is the collection of graphs collected from the last grow_step()
   // with (N-1) vertices.
-  void enumerate_final_step(const std::vector<Graph>&);
+  void enumerate_final_step(GraphSpan);
+
+  // Instead of the final enumeration, estimates the size of the search tree of each base graph
+  // with Knuth's estimator (see `EdgeGenerator::probe_search_tree()`), and prints the estimates
+  // with their 95% confidence intervals. The min_theta bound of each base graph is the smallest
+  // ratio among the leaves of a first round of probes. Since the actual enumeration may find
+  // smaller ratios, the estimates tend to be on the high side.
+  void estimate_final_step(GraphSpan);
+
+  // Estimates the number of nodes in the search tree of the given base graph with Knuth's
+  // estimator over two rounds of the given number of probes, seeded by the base graph id. The
+  // first round finds the min_theta bound, which is stored in `bound`, and the second round
+  // estimates the size with the bound. Stores the variance of the estimate in `variance`.
+  double estimate_search_tree(const EdgeCandidates& edge_candidates, const Graph& base,
+                              int base_graph_id, int probes, Fraction& bound,
+                              double& variance) const;
 
   // Prints the content of the canonicals after the growth to console and log files.
-  void print_before_final(const std::vector<Graph> collected_graphs[MAX_VERTICES]) const;
-  void print_state_to_stream(std::ostream& os,
-                             const std::vector<Graph> collected_graphs[MAX_VERTICES]) const;
+  void print_before_final(const GraphSpan collected_graphs[MAX_VERTICES]) const;
 
   // The entry point of the worker thread, used in the final enumeration phase.
   void worker_thread_main(int thread_id);
 
-  // The mutex to protect the counters under multi-threading.
-  std::mutex counters_mutex;
-  // The mutex to protect the queue and results under multi-threading.
-  std::mutex queue_mutex;
-  // The queue of base graphs to be processed in the final enumeration phase.
-  // The worker threads will dequeue graphs from this queue to work on.
-  std::queue<Graph> to_be_processed;
-  // The results of the final enumeration step.
-  // Values: 3-tuple (
-  //    id of the graph,
-  //    the base graph,
-  //    the graph with the minimum ratio among all graphs generated from the base graph).
-  std::vector<std::tuple<int, Graph, Graph>> results;
-  // The number of graphs that have been dequeued from the to_be_processed queue.
-  int to_be_processed_id;
+  // Returns the index of the first graph in graphs[0..count-1] that contains a forbidden subgraph
+  // with vertex N-1, or count if there is none. changed_edges[i] is the changed edge of graphs[i]
+  // (see `EdgeGenerator::get_changed_edge()`), which is only searched around if not 0.
+  int find_first_forbidden(Graph* graphs, const uint16* changed_edges, int count) const;
 
- protected:
-  // Returns the ratio of the given graph.
-  // The subclass must override this function, to implement which ratio to minimize in the search
-  // which may be theta_ratio, zeta_ratio, etc.
-  virtual Fraction get_ratio(const Graph& g) const = 0;
+  // Returns the index of the first graph with the minimum ratio in graphs[0..count-1], and
+  // stores the ratio in `ratio`. Returns -1 if count is 0.
+  int reduce_min_ratio(const Graph* graphs, int count, Fraction& ratio) const;
 
-  // Returns true if g contains a forbidden subgraph, which has v as a vertex.
-  // The subclass must override this function to implement which subgraph to forbid.
-  virtual bool contains_forbidden_subgraph(Graph& g, int v) const = 0;
+  // Enumerates all graphs of the given prefix range of the base graph in `job`, then merges the
+  // result into the job. The last range of a job to finish records the job's result. If the
+  // range was saved in a checkpoint, the enumeration continues from the saved state. Returns
+  // false if the worker stopped before the range is done, see `request_stop()`.
+  bool process_range(int thread_id, const EdgeCandidates& edge_candidates, BaseGraphJob& job,
+                     EnumRange& range);
+
+  // Adds the min ratio graph, the number of processed graphs and the edge gen stats of a range to
+  // Counters, adds the latter two and the forbidden subgraph tests to `perf`, and clears them.
+  // Must hold counters_mutex.
+  void flush_stats(const Graph& min_ratio_graph, uint64& graphs_processed, uint64& forbidden_tests,
+                   EdgeGenerator& edge_gen, BaseGraphPerf& perf) const;
 
  public:
-  // Constructs the Grower object.
-  // log_stream is used for status reporting and debugging purpose.
-  Grower(int num_worker_threads_, bool skip_final_enum_, bool use_min_theta_opt_,
-         bool use_contains_Tk_opt_, int start_idx_, int end_idx_, bool search_ratio_graph_ = false,
-         Fraction ratio_to_search_ = Fraction(1, 1));
+  // Constructs the Grower object with a default constructed policy, see `GrowerBase`.
+  using GrowerBase::GrowerBase;
 
-  // Sets the logging streams.
-  // If `details_per_graph` is true, print the min ratio value from each base graph into
-  // the details log.
-  void set_logging(std::ostream* summary, std::ostream* detail, std::ostream* result);
+  // Constructs the Grower object with the given policy, followed by the arguments of GrowerBase.
+  template <typename... GrowerArgs>
+  Grower(const Policy& policy_, GrowerArgs... args) : GrowerBase(args...), policy(policy_) {}
 
   // Finds all canonical isomorphism class representations with up to max_n vertices.
   void grow();
+};
 
-  // Returns the growth results.
-  const std::vector<std::tuple<int, Graph, Graph>>& get_results() const { return results; }
+// Find all canonical isomorphism class representations with up to max_n vertices.
+template <typename Policy>
+void Grower<Policy>::grow() {
+  assert(Graph::N <= MAX_VERTICES);
+  if (orderly_generation && !policy.forbidden_is_monotone()) {
+    std::cout << "The orderly generation requires a monotone forbidden subgraph property, "
+                 "growing without it.\n";
+    orderly_generation = false;
+  }
+
+  std::vector<Graph> collected_graphs[MAX_VERTICES];
+  // The graphs of each order, either grown into collected_graphs[] or in the growth snapshot.
+  GraphSpan levels[MAX_VERTICES];
+  int loaded_order = Graph::K - 2;
+  GrowthSnapshot snapshot;
+  const std::string problem_name = policy.get_problem_name();
+  // The orderly generation collects other representatives, so it has its own snapshots.
+  const std::string snapshot_name = orderly_generation ? problem_name + "_orderly" : problem_name;
+  if (!growth_snapshot_dir.empty() && snapshot.open(growth_snapshot_dir, snapshot_name)) {
+    // Start from the stored levels. Each level has all non-empty graphs of the previous one, so
+    // the empty graph and the last level have each graph once, as if they were grown. The levels
+    // are used from the mapping without copying. A snapshot of another N needs canonicalizing
+    // and sorting again: the last level, which is grown or enumerated from, and all levels if
+    // they are written into a new snapshot. The other levels are only printed.
+    loaded_order = snapshot.get_max_order();
+    for (int n = Graph::K - 1; n <= loaded_order; n++) levels[n] = snapshot.get_level(n);
+    if (snapshot.get_n() != Graph::N) {
+      for (int n = loaded_order < Graph::N - 1 ? Graph::K - 1 : loaded_order; n <= loaded_order;
+           n++) {
+        snapshot.read_level(n, collected_graphs[n]);
+        levels[n] = collected_graphs[n];
+      }
+    }
+    for (int n : {Graph::K - 1, loaded_order}) {
+      for (const Graph& g : levels[n]) Counters::observe_ratio(g, policy.get_ratio(g));
+    }
+    std::cout << "Loaded the graphs up to " << loaded_order << " vertices from the growth snapshot "
+              << GrowthSnapshot::get_path(growth_snapshot_dir, snapshot_name, snapshot.get_n())
+              << "\n";
+  } else {
+    // Initialize empty graph with k-1 vertices.
+    Graph g;
+    g.canonicalize();
+    collected_graphs[Graph::K - 1].push_back(g);
+    levels[Graph::K - 1] = collected_graphs[Graph::K - 1];
+    Counters::observe_ratio(g, policy.get_ratio(g));
+  }
+
+  // First grow to N-1 vertices, accumulate one graph from each isomorphic class.
+  for (int n = std::max(loaded_order + 1, Graph::K); n < Graph::N; n++) {
+    if (stop_requested) {
+      // The checkpoint only covers the final enumeration phase, so there is nothing to save. An
+      // existing checkpoint is left as it is.
+      std::cout << "Stopped in the growth phase before " << n << " vertices.\n";
+      interrupted = true;
+      return;
+    }
+    collected_graphs[n] = grow_step(n, levels[n - 1]);
+    levels[n] = collected_graphs[n];
+  }
+  if (!growth_snapshot_dir.empty() && loaded_order < Graph::N - 1 &&
+      !GrowthSnapshot::write(growth_snapshot_dir, snapshot_name, levels)) {
+    std::cout << "Failed to write the growth snapshot into " << growth_snapshot_dir << "\n";
+  }
+  Counters::print_counters();
+  print_before_final(levels);
+
+  if (!skip_final_enum && estimate_probes > 0) {
+    estimate_final_step(levels[Graph::N - 1]);
+  } else if (!skip_final_enum) {
+    // Finally, enumerate all graphs with N vertices, no need to store graphs.
+    if (is_coordinator) {
+      coordinate_final_step(levels[Graph::N - 1], problem_name);
+    } else {
+      enumerate_final_step(levels[Graph::N - 1]);
+    }
+    if (interrupted) return;
+    std::sort(results.begin(), results.end());
+    if (log_result != nullptr && !search_ratio_graph) {
+      for (const auto& r : results) {
+        int base_graph_id = std::get<0>(r);
+        const Graph& base_graph = std::get<1>(r);
+        const Graph& min_ratio_graph = std::get<2>(r);
+        // If the graph's ratio is the global minimum, print into the result log.
+        const Fraction ratio = policy.get_ratio(min_ratio_graph);
+        if (ratio == Counters::get_min_ratio()) {
+          *log_result << "G[" << base_graph_id << "] min_ratio=" << ratio.to_string() << "\n  ";
+          base_graph.print_concise(*log_result, true);
+          *log_result << "  ";
+          min_ratio_graph.print_concise(*log_result, true);
+        }
+      }
+      log_result->flush();
+    }
+  } else {
+    std::cout << "Skipped.\n";
+  }
+}
+
+// Constructs all non-isomorphic graphs with n vertices that are T_k-free,
+// and add them to the canonicals. Before calling this, all such graphs
+// with <n vertices must already be in the canonicals.
+// Note all edges added in this step contains vertex (n-1).
+template <typename Policy>
+std::vector<Graph> Grower<Policy>::grow_step(int n, GraphSpan base_graphs) {
+  assert(n < Graph::N);
+  if (orderly_generation) return grow_step_orderly(n, base_graphs);
+  EdgeCandidates edge_candidates(n);
+  Counters::new_growth_step(n, base_graphs.size());
+  std::unordered_set<Graph, GraphHasher, GraphComparer> results;
+  std::unique_ptr<GrowthSpill> spill;
+  if (!growth_spill_dir.empty()) {
+    spill = std::make_unique<GrowthSpill>(growth_spill_dir, growth_memory_budget,
+                                          num_worker_threads);
+    if (!spill->is_open()) {
+      std::cout << "Failed to create the spill files in " << growth_spill_dir << "\n";
+      exit(-1);
+    }
+  }
+  // Adds the graph to the results. Returns true if it's not isomorphic to an earlier one, which
+  // is only known without spilling.
+  auto add_result = [&results, &spill, this](const Graph& g) {
+    if (spill != nullptr) {
+      if (!spill->add(g)) {
+        std::cout << "Failed to write the spill files in " << growth_spill_dir << "\n";
+        exit(-1);
+      }
+      return false;
+    }
+    return results.insert(g).second;
+  };
+
+  // Add all non-empty graphs from the previous step to the results.
+  uint64 base_graph_count = 0;
+  for (const Graph& g : base_graphs) {
+    if (g.get_edge_count() > 0) {
+      add_result(g);
+      base_graph_count++;
+    }
+  }
+
+  // This data structure will be reused when processing the graphs.
+  Graph copy;
+  const bool skip_supersets = policy.forbidden_is_monotone();
+
+  for (const Graph& g : base_graphs) {
+    Counters::increment_growth_processed_graphs_in_current_step();
+    EdgeGenerator edge_gen(edge_candidates, g);
+
+    // Loop through all ((K+1)^\binom{n-1}{k-1} - 1) edge combinations, add them to g, and check
+    // add to canonicals unless it's isomorphic to an existing one.
+    while (edge_gen.next(copy)) {
+      // Most of the time only the lowest digit changed, and only the changed edge is searched.
+      // This needs the previous graph to be free of the forbidden subgraph, or skipped.
+      const uint16 changed_edge = skip_supersets ? edge_gen.get_changed_edge() : 0;
+      if (changed_edge != 0 ? policy.contains_forbidden_subgraph_with_edge(copy, changed_edge)
+                            : policy.contains_forbidden_subgraph(copy, n - 1)) {
+        if (skip_supersets) edge_gen.notify_contain_tk_skip();
+        continue;
+      }
+
+      copy.canonicalize();
+
+      if (add_result(copy)) Counters::observe_ratio(copy, policy.get_ratio(copy));
+    }
+  }
+
+  if (spill != nullptr) {
+    // Observe the new graphs as if they were added in the order found: the first one with the
+    // min ratio, then the others, which don't change the min ratio graph.
+    std::vector<Graph> new_graphs;
+    Graph min_ratio_graph;
+    Fraction min_ratio = Fraction::infinity();
+    uint64 min_ratio_sequence = 0, new_graph_count = 0;
+    const bool ok = spill->finish(new_graphs, [&](const Graph& g, uint64 sequence) {
+      if (sequence < base_graph_count) return;
+      const Fraction ratio = policy.get_ratio(g);
+      if (new_graph_count++ == 0 || ratio < min_ratio ||
+          (ratio == min_ratio && sequence < min_ratio_sequence)) {
+        min_ratio_graph = g;
+        min_ratio = ratio;
+        min_ratio_sequence = sequence;
+      }
+    });
+    if (!ok) {
+      std::cout << "Failed to deduplicate the spill files in " << growth_spill_dir << "\n";
+      exit(-1);
+    }
+    if (new_graph_count > 0) Counters::observe_ratio(min_ratio_graph, min_ratio, new_graph_count);
+    return new_graphs;
+  }
+  std::vector<Graph> new_graphs(results.cbegin(), results.cend());
+  std::sort(new_graphs.begin(), new_graphs.end());
+  return new_graphs;
+}
+
+template <typename Policy>
+std::vector<Graph> Grower<Policy>::grow_step_orderly(int n, GraphSpan base_graphs) {
+  Counters::new_growth_step(n, base_graphs.size());
+  const bool skip_supersets = policy.forbidden_is_monotone();
+  // The accepted extensions of each base graph, in the order generated.
+  std::vector<std::vector<Graph>> extensions(base_graphs.size());
+  std::atomic<size_t> next_base{0};
+
+  auto extend_base_graphs = [&] {
+    EdgeCandidates edge_candidates(n);
+    Graph copy;
+    for (size_t i; (i = next_base++) < base_graphs.size();) {
+      EdgeGenerator edge_gen(edge_candidates, base_graphs[i]);
+      // The accepted extensions of a base graph are only isomorphic to each other.
+      std::unordered_set<Graph, GraphHasher, GraphComparer> accepted;
+      while (edge_gen.next(copy)) {
+        const uint16 changed_edge = skip_supersets ? edge_gen.get_changed_edge() : 0;
+        if (changed_edge != 0 ? policy.contains_forbidden_subgraph_with_edge(copy, changed_edge)
+                              : policy.contains_forbidden_subgraph(copy, n - 1)) {
+          if (skip_supersets) edge_gen.notify_contain_tk_skip();
+          continue;
+        }
+        if (!copy.is_canonical_augmentation(n)) continue;
+        copy.canonicalize();
+        if (accepted.insert(copy).second) extensions[i].push_back(copy);
+      }
+    }
+  };
+  std::vector<std::thread> threads;
+  for (int i = 1; i < num_worker_threads; i++) threads.push_back(std::thread(extend_base_graphs));
+  extend_base_graphs();
+  for (std::thread& t : threads) t.join();
+
+  // The graphs with an isolated vertex are the non-empty ones of the previous step.
+  std::vector<Graph> new_graphs;
+  for (const Graph& g : base_graphs) {
+    if (g.get_edge_count() > 0) new_graphs.push_back(g);
+  }
+  for (const std::vector<Graph>& graphs : extensions) {
+    Counters::increment_growth_processed_graphs_in_current_step();
+    for (const Graph& g : graphs) {
+      Counters::observe_ratio(g, policy.get_ratio(g));
+      new_graphs.push_back(g);
+    }
+  }
+  std::sort(new_graphs.begin(), new_graphs.end());
+  return new_graphs;
+}
+
+template <typename Policy>
+void Grower<Policy>::enumerate_final_step(GraphSpan base_graphs) {
+  prepare_final_step(base_graphs);
+  search_key = get_search_key(policy.get_problem_name());
+  if (!coordinator_address.empty()) {
+    coordinator_client = std::make_unique<CoordinatorClient>();
+    if (!coordinator_client->connect(coordinator_address, search_key)) {
+      std::cout << "Can't connect to the coordinator at " << coordinator_address
+                << ", or it runs another search.\n";
+      interrupted = true;
+      coordinator_client.reset();
+      return;
+    }
+    worker_base_graphs = base_graphs;
+  }
+  if (resume_from_checkpoint) {
+    if (!read_checkpoint()) {
+      std::cout << "The checkpoint " << checkpoint_path << " doesn't match this search.\n";
+      interrupted = true;
+      jobs.clear();
+      return;
+    }
+    // The restored results take part in the min ratio, as if they were found in this run.
+    for (const auto& r : results) {
+      Counters::observe_ratio(std::get<2>(r), policy.get_ratio(std::get<2>(r)), 0);
+    }
+    for (const BaseGraphJob& job : jobs) {
+      if (job.pending_ranges > 0 && job.min_ratio != Fraction::infinity()) {
+        Counters::observe_ratio(job.min_ratio_graph, policy.get_ratio(job.min_ratio_graph), 0);
+      }
+    }
+  }
+  last_checkpoint_time = std::chrono::steady_clock::now();
+
+  std::vector<double> costs;
+  if (longest_first_probes > 0) {
+    EdgeCandidates edge_candidates(Graph::N);
+    Fraction bound = Fraction::infinity();
+    double variance;
+    for (const BaseGraphJob& job : jobs) {
+      costs.push_back(job.pending_ranges == 0
+                          ? 0
+                          : estimate_search_tree(edge_candidates, job.base, job.base_graph_id,
+                                                 longest_first_probes, bound, variance));
+    }
+  }
+  schedule_jobs(costs);
+
+  logger = std::make_unique<AsyncLogger<LogRecord>>(
+      [this](const LogRecord& record) { write_log_record(record); }, [this] { flush_logs(); });
+  worker_cpus.clear();
+  if (placement != PlacementPolicy::NONE) {
+    const CpuTopology topology = CpuTopology::detect();
+    for (int i = 0; i < num_worker_threads; i++) {
+      worker_cpus.push_back(topology.get_worker_cpu(placement, i));
+    }
+  }
+  monitor_stop = false;
+  std::thread monitor_thread(&Grower::monitor_thread_main, this);
+  if (num_worker_threads == 0) {
+    worker_thread_main(0);
+  } else {
+    // The worker threads used in the final enumeration phase.
+    std::vector<std::thread> worker_threads;
+
+    // Start the threads.
+    for (int i = 0; i < num_worker_threads; i++) {
+      worker_threads.push_back(std::thread(&Grower::worker_thread_main, this, i));
+    }
+
+    // Wait for them to finish.
+    for (std::thread& t : worker_threads) {
+      t.join();
+    }
+  }
+  // Stop the monitor thread.
+  {
+    std::scoped_lock lock(monitor_mutex);
+    monitor_stop = true;
+  }
+  monitor_cv.notify_one();
+  monitor_thread.join();
+  // Write the remaining log records.
+  logger.reset();
+  if (!checkpoint_path.empty()) {
+    write_checkpoint();
+    if (interrupted) {
+      std::cout << "Stopped, the progress is saved in " << checkpoint_path << "\n";
+    }
+  }
+  coordinator_client.reset();
+  jobs.clear();
+}
+
+template <typename Policy>
+void Grower<Policy>::estimate_final_step(GraphSpan base_graphs) {
+  int max_idx = static_cast<int>(base_graphs.size());
+  if (end_idx > 0 && end_idx < max_idx) {
+    max_idx = end_idx + 1;
+  }
+  EdgeCandidates edge_candidates(Graph::N);
+  double total_nodes = 0;
+  double total_variance = 0;
+  for (int i = start_idx; i < max_idx; i++) {
+    const auto start_time = std::chrono::steady_clock::now();
+    Fraction bound = Fraction::infinity();
+    double variance;
+    const double mean =
+        estimate_search_tree(edge_candidates, base_graphs[i], i, estimate_probes, bound, variance);
+    const double half_width = 1.96 * std::sqrt(variance);
+    estimates.push_back(std::make_tuple(i, mean, half_width));
+    total_nodes += mean;
+    total_variance += variance;
+
+    const auto now = std::chrono::steady_clock::now();
+    const int milliseconds =
+        std::chrono::duration_cast<std::chrono::milliseconds>(now - start_time).count();
+    std::ostringstream line;
+    line << "G[" << i << "] estimated nodes = " << mean << " +- " << half_width
+         << ", bound = " << bound.to_string() << ", time = " << milliseconds << "ms\n";
+    std::cout << line.str();
+    if (log_detail != nullptr) {
+      *log_detail << line.str();
+    }
+  }
+  std::ostringstream summary;
+  summary << "Total estimated nodes = " << total_nodes << " +- "
+          << 1.96 * std::sqrt(total_variance) << " (95% confidence)\n";
+  std::cout << summary.str();
+  if (log != nullptr) {
+    *log << summary.str();
+  }
+}
+
+template <typename Policy>
+double Grower<Policy>::estimate_search_tree(const EdgeCandidates& edge_candidates,
+                                            const Graph& base, int base_graph_id, int probes,
+                                            Fraction& bound, double& variance) const {
+  auto contains = [this](Graph& g) { return policy.contains_forbidden_subgraph(g, Graph::N - 1); };
+  // Without the superset skips, the enumeration doesn't prune the subtrees of the graphs
+  // containing the forbidden subgraph, but the leaves still need to be free of it.
+  const bool skip_supersets = policy.forbidden_is_monotone();
+  auto prune = [&contains, skip_supersets](Graph& g) { return skip_supersets && contains(g); };
+  Graph leaf;
+  // Seeded by the base graph id, so that the estimates are reproducible.
+  std::mt19937 rng(base_graph_id);
+  EdgeGenerator edge_gen(edge_candidates, base);
+  edge_gen.set_candidate_order(candidate_order);
+  edge_gen.set_min_degree_filter(min_degree_filter);
+  edge_gen.set_ratio_bound(policy.get_ratio_bound());
+
+  // First round: find a bound for the min_theta pruning, like the enumeration would.
+  bound = Fraction::infinity();
+  double estimate;
+  if (search_ratio_graph) {
+    bound = ratio_to_search + Fraction::epsilon();
+  } else {
+    for (int p = 0; p < probes; p++) {
+      if (edge_gen.probe_search_tree(rng, bound, prune, estimate, leaf) &&
+          (skip_supersets || !contains(leaf))) {
+        bound = std::min(bound, policy.get_ratio(leaf));
+      }
+    }
+  }
+
+  // Second round: estimate the tree size with the bound, if the enumeration would use it.
+  const Fraction pruning_bound = use_min_theta_opt ? bound : Fraction::infinity();
+  double sum = 0;
+  double sum_squares = 0;
+  for (int p = 0; p < probes; p++) {
+    edge_gen.probe_search_tree(rng, pruning_bound, prune, estimate, leaf);
+    sum += estimate;
+    sum_squares += estimate * estimate;
+  }
+  const double mean = sum / probes;
+  variance = probes > 1 ? std::max(0.0, sum_squares - sum * mean) / (probes - 1) / probes : 0;
+  return mean;
+}
+
+template <typename Policy>
+void Grower<Policy>::worker_thread_main(int thread_id) {
+  // Pin the thread first, so that the memory it allocates is on its NUMA node.
+  if (!worker_cpus.empty() && !CpuTopology::pin_current_thread(worker_cpus[thread_id])) {
+    std::cout << "Failed to pin worker thread " << thread_id << " to CPU " << worker_cpus[thread_id]
+              << "\n";
+  }
+  // These instances will be reused when processing the graphs.
+  EdgeCandidates edge_candidates(Graph::N);
+  BaseGraphJob* job;
+  std::unique_ptr<EnumRange> range;
+
+  while (true) {
+    if (acquire_work(thread_id, job, range)) {
+      if (!process_range(thread_id, edge_candidates, *job, *range)) break;
+    } else if (!wait_for_coordinator()) {
+      break;
+    }
+  }
+}
+
+template <typename Policy>
+int Grower<Policy>::find_first_forbidden(Graph* graphs, const uint16* changed_edges,
+                                         int count) const {
+  for (int i = 0; i < count; i++) {
+    if (changed_edges[i] != 0
+            ? policy.contains_forbidden_subgraph_with_edge(graphs[i], changed_edges[i])
+            : policy.contains_forbidden_subgraph(graphs[i], Graph::N - 1)) {
+      return i;
+    }
+  }
+  return count;
+}
+
+template <typename Policy>
+int Grower<Policy>::reduce_min_ratio(const Graph* graphs, int count, Fraction& ratio) const {
+  int min_idx = -1;
+  for (int i = 0; i < count; i++) {
+    const Fraction r = policy.get_ratio(graphs[i]);
+    if (min_idx < 0 || r < ratio) {
+      ratio = r;
+      min_idx = i;
+    }
+  }
+  return min_idx;
+}
+
+template <typename Policy>
+void Grower<Policy>::flush_stats(const Graph& min_ratio_graph, uint64& graphs_processed,
+                                 uint64& forbidden_tests, EdgeGenerator& edge_gen,
+                                 BaseGraphPerf& perf) const {
+  Counters::observe_ratio(min_ratio_graph, policy.get_ratio(min_ratio_graph), graphs_processed);
+  perf.graphs += graphs_processed;
+  perf.forbidden_tests += forbidden_tests + edge_gen.stats_forbidden_tests;
+  perf.edge_sets += edge_gen.stats_edge_sets;
+  perf.enum_states += edge_gen.stats_enum_states;
+  perf.tk_skip += edge_gen.stats_tk_skip;
+  perf.tk_skip_bits += edge_gen.stats_tk_skip_bits;
+  perf.theta_edges_skip += edge_gen.stats_theta_edges_skip;
+  perf.theta_directed_edges_skip += edge_gen.stats_theta_directed_edges_skip;
+  graphs_processed = 0;
+  forbidden_tests = 0;
+  Counters::observe_edgegen_stats(
+      edge_gen.stats_tk_skip, edge_gen.stats_tk_skip_bits, edge_gen.stats_theta_edges_skip,
+      edge_gen.stats_theta_directed_edges_skip, edge_gen.stats_edge_sets);
+  edge_gen.clear_stats();
+}
+
+template <typename Policy>
+bool Grower<Policy>::process_range(int thread_id, const EdgeCandidates& edge_candidates,
+                                   BaseGraphJob& job, EnumRange& range) {
+  const Graph& base = job.base;
+  const int base_graph_id = job.base_graph_id;
+  WorkerStats& stats = worker_stats[thread_id];
+  stats.base_graph_id.store(base_graph_id, std::memory_order_relaxed);
+  const auto start_time = std::chrono::steady_clock::now();
+  Graph batch[EDGE_GEN_BATCH_SIZE];
+  Graph min_ratio_graph;
+
+  Fraction min_ratio = Fraction::infinity();
+  if (search_ratio_graph) {
+    // If we are searching all graphs generating the given ratio value, set min_ratio
+    // to be slightly higher than the given value so that the min_ratio optimization
+    // won't skip any graph that produces the ratio value.
+    min_ratio = ratio_to_search + Fraction::epsilon();
+  }
+  // The bound used by the min_theta optimization. Other ranges of the same base graph may have
+  // found smaller ratios, which can be used to skip more graphs. But graphs with the same ratio
+  // as the other ranges can't be skipped, since this range may come first in the enumeration
+  // order, and therefore wins the tie.
+  Fraction bound = min_ratio;
+  // The shared min ratio of the job when `bound` was last tightened with it.
+  uint64 seen_shared_min_ratio = pack_fraction(Fraction::infinity());
+
+  uint64 graphs_processed = 0;
+  // The forbidden subgraph tests done here, not by the edge generator.
+  uint64 forbidden_tests = 0;
+  EdgeGenerator edge_gen(edge_candidates, base);
+  edge_gen.set_candidate_order(candidate_order);
+  // With the T_k filter, all graphs returned by the edge generator are T_k-free.
+  const bool skip_supersets = policy.forbidden_is_monotone();
+  const bool tk_filter = use_contains_Tk_opt && skip_supersets && policy.forbids_Tk();
+  edge_gen.set_Tk_filter(tk_filter);
+  if (!policy.forbids_Tk()) {
+    edge_gen.set_contains_forbidden(
+        [this](Graph& g) { return policy.contains_forbidden_subgraph(g, Graph::N - 1); });
+  }
+  edge_gen.set_ratio_bound(policy.get_ratio_bound());
+  edge_gen.set_min_degree_filter(min_degree_filter);
+  edge_gen.restrict_to_range(prefix_digits, &range);
+  // Continue from the checkpoint if the range was saved in one.
+  RangeProgress resumed;
+  {
+    std::scoped_lock lock(counters_mutex);
+    resumed = worker_slots[thread_id].progress;
+    if (!job.perf.started) {
+      job.perf.started = true;
+      job.perf.start_time = start_time;
+    }
+  }
+  if (resumed.started) {
+    edge_gen.restore_state(resumed.state);
+    min_ratio = resumed.min_ratio;
+    min_ratio_graph = resumed.min_ratio_graph;
+    bound = min_ratio;
+  }
+  // The graphs after a forbidden one in a batch are generated again, and the graphs in a batch
+  // don't benefit from a smaller bound found in the same batch. So the batch size adapts: it's
+  // halved after a batch with a forbidden subgraph or a smaller ratio, and doubled otherwise.
+  int max_batch_size = 1;
+  int batch_size;
+  while ((batch_size = edge_gen.next_batch(batch, max_batch_size, use_min_theta_opt, bound)) > 0) {
+    // Another range of the same base graph found a smaller ratio. Only unpacked when it changes.
+    const uint64 shared_min_ratio = job.shared_min_ratio.load(std::memory_order_relaxed);
+    if (shared_min_ratio != seen_shared_min_ratio && !search_ratio_graph) {
+      seen_shared_min_ratio = shared_min_ratio;
+      const Fraction shared = unpack_fraction(shared_min_ratio);
+      if (shared != Fraction::infinity() && shared + Fraction::epsilon() < bound) {
+        bound = shared + Fraction::epsilon();
+      }
+    }
+
+    // The skip feedback reaches the edge generator at the batch boundary: the graphs after the
+    // first one containing a forbidden subgraph are dropped, since the skip may cover them. The
+    // ones not covered are generated again in the next batch.
+    int valid_count = batch_size;
+    if (!skip_supersets) {
+      // Without the superset skips, the graphs containing the forbidden subgraph are dropped
+      // from the batch one by one.
+      valid_count = 0;
+      forbidden_tests += batch_size;
+      for (int i = 0; i < batch_size; i++) {
+        if (policy.contains_forbidden_subgraph(batch[i], Graph::N - 1)) continue;
+        if (valid_count != i) batch[valid_count] = batch[i];
+        ++valid_count;
+      }
+    } else if (!tk_filter) {
+      valid_count = find_first_forbidden(batch, edge_gen.get_batch_changed_edges(), batch_size);
+      forbidden_tests += std::min(valid_count + 1, batch_size);
+      if (valid_count < batch_size) {
+        edge_gen.rewind_batch(valid_count);
+        edge_gen.notify_contain_tk_skip();
+      }
+    }
+    bool shrink_batch = skip_supersets && valid_count < batch_size;
+
+    // Bookkeeping: retain the minimum ratio value encountered so far, and the graph genreated it.
+    graphs_processed += valid_count;
+    WorkerStats::add(stats.graphs_generated, batch_size);
+    WorkerStats::add(stats.graphs_processed, valid_count);
+    if (!search_ratio_graph) {
+      // Normal path: we are searching for min_ratio.
+      Fraction batch_min_ratio = Fraction::infinity();
+      const int min_idx = reduce_min_ratio(batch, valid_count, batch_min_ratio);
+      if (min_idx >= 0 && batch_min_ratio < min_ratio) {
+        min_ratio = batch_min_ratio;
+        min_ratio_graph = batch[min_idx];
+        bound = std::min(bound, min_ratio);
+        shrink_batch = true;
+        // Publish the new ratio to the other ranges of the same base graph.
+        uint64 shared = job.shared_min_ratio.load();
+        while (min_ratio < unpack_fraction(shared) &&
+               !job.shared_min_ratio.compare_exchange_weak(shared, pack_fraction(min_ratio))) {
+        }
+      }
+    } else {
+      // Here we are searching for all graphs that produce the given ratio value.
+      for (int i = 0; i < valid_count; i++) {
+        const Graph& copy = batch[i];
+        const Fraction ratio = policy.get_ratio(copy);
+        if (ratio <= ratio_to_search) {
+          logger->push(LogRecord{LogRecord::Type::RATIO_GRAPH_FOUND, base_graph_id, thread_id,
+                                 ratio, policy.get_ratio(base), base, copy, BaseGraphPerf{}});
+          std::scoped_lock lock(counters_mutex);
+          Counters::notify_ratio_graph_found(copy, ratio);
+        }
+      }
+    }
+    if (shrink_batch) {
+      max_batch_size = std::max(max_batch_size / 2, 1);
+    } else {
+      max_batch_size = std::min(max_batch_size * 2, EDGE_GEN_BATCH_SIZE);
+    }
+
+    // The enumeration state can only be saved after the batch is processed.
+    if (!checkpoint_path.empty()) {
+      if (stats.save_requested.load(std::memory_order_relaxed) ||
+          stop_requested.load(std::memory_order_relaxed)) {
+        stats.save_requested.store(false, std::memory_order_relaxed);
+        std::scoped_lock lock(counters_mutex);
+        flush_stats(min_ratio_graph, graphs_processed, forbidden_tests, edge_gen, job.perf);
+        if (save_progress(thread_id, edge_gen, range, min_ratio, min_ratio_graph)) {
+          return false;
+        }
+      }
+    }
+  }
+
+  // The lock scope to merge the result into the job, and add the min ratio to the global Counters.
+  std::unique_lock lock(counters_mutex);
+  // The range is done, so it's no longer available for stealing.
+  worker_slots[thread_id].job = nullptr;
+  worker_slots[thread_id].range = nullptr;
+  stats.base_graph_id.store(-1, std::memory_order_relaxed);
+  flush_stats(min_ratio_graph, graphs_processed, forbidden_tests, edge_gen, job.perf);
+  const auto end_time = std::chrono::steady_clock::now();
+  job.perf.threads.push_back(thread_id);
+  job.perf.thread_seconds += std::chrono::duration<double>(end_time - start_time).count();
+  if (min_ratio < job.min_ratio ||
+      (min_ratio == job.min_ratio && range.get_begin() < job.min_ratio_range_begin)) {
+    job.min_ratio = min_ratio;
+    job.min_ratio_graph = min_ratio_graph;
+    job.min_ratio_range_begin = range.get_begin();
+  }
+  if (--job.pending_ranges > 0) return true;
+
+  results.push_back(std::make_tuple(base_graph_id, base, job.min_ratio_graph));
+  // The job is complete, so no other thread changes it after the lock is released.
+  lock.unlock();
+  if (coordinator_client != nullptr) {
+    bool sent;
+    {
+      std::scoped_lock coordinator_lock(coordinator_mutex);
+      sent = coordinator_client->send_result(base_graph_id, job.min_ratio, job.min_ratio_graph);
+    }
+    if (!sent) {
+      std::cout << "Lost the connection to the coordinator, the result of G[" << base_graph_id
+                << "] is only in the logs of this worker.\n";
+      std::scoped_lock relock(counters_mutex);
+      interrupted = true;
+      worker_done = true;
+    }
+  }
+  if (log_detail != nullptr && !search_ratio_graph) {
+    logger->push(LogRecord{LogRecord::Type::BASE_GRAPH_RESULT, base_graph_id, thread_id,
+                           job.min_ratio, Fraction::infinity(), base, job.min_ratio_graph,
+                           BaseGraphPerf{}});
+  }
+  if (log_perf != nullptr) {
+    job.perf.wall_seconds = std::chrono::duration<double>(end_time - job.perf.start_time).count();
+    logger->push(LogRecord{LogRecord::Type::BASE_GRAPH_PERF, base_graph_id, thread_id,
+                           job.min_ratio, Fraction::infinity(), base, job.min_ratio_graph,
+                           job.perf});
+  }
+  return true;
+}
+
+// Print the content of the collected graphs after the growth to console and log files.
+template <typename Policy>
+void Grower<Policy>::print_before_final(const GraphSpan collected_graphs[MAX_VERTICES]) const {
+  if (log != nullptr) {
+    print_state_to_stream(std::cout, collected_graphs);
+    print_state_to_stream(*log, collected_graphs);
+    log->flush();
+  }
+  if (log_detail != nullptr) {
+    for (int i = 0; i < Graph::N; i++) {
+      Fraction min_ratio = Fraction::infinity();
+      for (const Graph& g : collected_graphs[i]) {
+        min_ratio = std::min(min_ratio, policy.get_ratio(g));
+      }
 
-  // For debugging and testing purpose: override the number of generations and seconds
-  // between printing stats.
-  void set_stats_print_interval(uint64 check_every_n_gen, int print_every_n_seconds);
-};
\ No newline at end of file
+      *log_detail << "-------- Accumulated canonicals[order=" << i
+                  << "] : count = " << collected_graphs[i].size()
+                  << ", min_ratio = " << min_ratio.to_string() << " --------\n";
+      int idx = 0;
+      for (const Graph& g : collected_graphs[i]) {
+        *log_detail << "  [" << idx++ << "] ";
+        g.print_concise(*log_detail, true);
+      }
+    }
+    log_detail->flush();
+  }
+}
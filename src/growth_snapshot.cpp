@@ -0,0 +1,111 @@
+#include "growth_snapshot.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// The graphs are written and mapped as raw bytes.
+static_assert(std::is_trivially_copyable<Graph>::value);
+
+constexpr char GrowthSnapshot::MAGIC[8];
+
+std::string GrowthSnapshot::get_path(const std::string& dir, const std::string& problem, int n) {
+  return dir + "/" + problem + "_k" + std::to_string(Graph::K) + "_n" + std::to_string(n) +
+         ".growth";
+}
+
+bool GrowthSnapshot::write(const std::string& dir, const std::string& problem,
+                           const GraphSpan collected_graphs[MAX_VERTICES]) {
+  if (problem.size() >= MAX_PROBLEM_LENGTH) return false;
+  Header h{};
+  std::copy(MAGIC, MAGIC + sizeof(MAGIC), h.magic);
+  h.version = VERSION;
+  h.graph_size = sizeof(Graph);
+  h.k = Graph::K;
+  h.n = Graph::N;
+  std::copy(problem.begin(), problem.end(), h.problem);
+  uint64 offset = sizeof(Header);
+  for (int n = Graph::K - 1; n < Graph::N; n++) {
+    h.counts[n] = collected_graphs[n].size();
+    h.offsets[n] = offset;
+    offset += h.counts[n] * sizeof(Graph);
+  }
+
+  const std::string path = get_path(dir, problem, Graph::N);
+  const std::string tmp_path = path + ".tmp";
+  {
+    std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    for (int n = Graph::K - 1; n < Graph::N; n++) {
+      out.write(reinterpret_cast<const char*>(collected_graphs[n].begin()),
+                collected_graphs[n].size() * sizeof(Graph));
+    }
+    out.flush();
+    if (!out) {
+      std::remove(tmp_path.c_str());
+      return false;
+    }
+  }
+  return std::rename(tmp_path.c_str(), path.c_str()) == 0;
+}
+
+bool GrowthSnapshot::open(const std::string& dir, const std::string& problem) {
+  close();
+  for (int n = Graph::N; n <= MAX_VERTICES; n++) {
+    if (open_file(get_path(dir, problem, n), problem)) return true;
+  }
+  for (int n = Graph::N - 1; n > Graph::K; n--) {
+    if (open_file(get_path(dir, problem, n), problem)) return true;
+  }
+  return false;
+}
+
+bool GrowthSnapshot::open_file(const std::string& path, const std::string& problem) {
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+  struct stat st;
+  void* data = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= sizeof(Header)) {
+    data = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  }
+  ::close(fd);
+  if (data == MAP_FAILED) return false;
+  header = static_cast<const Header*>(data);
+  mapped_size = st.st_size;
+
+  bool valid = std::equal(MAGIC, MAGIC + sizeof(MAGIC), header->magic) &&
+               header->version == VERSION && header->graph_size == sizeof(Graph) &&
+               static_cast<int>(header->k) == Graph::K &&
+               static_cast<int>(header->n) > Graph::K && header->n <= MAX_VERTICES &&
+               strncmp(header->problem, problem.c_str(), MAX_PROBLEM_LENGTH) == 0;
+  for (int n = Graph::K - 1; valid && n < static_cast<int>(header->n); n++) {
+    valid = header->offsets[n] % alignof(Graph) == 0 && header->offsets[n] <= mapped_size &&
+            header->counts[n] <= (mapped_size - header->offsets[n]) / sizeof(Graph);
+  }
+  if (!valid) close();
+  return valid;
+}
+
+void GrowthSnapshot::close() {
+  if (header != nullptr) {
+    munmap(const_cast<Header*>(header), mapped_size);
+    header = nullptr;
+    mapped_size = 0;
+  }
+}
+
+const Graph* GrowthSnapshot::get_graphs(int n) const {
+  assert(n >= Graph::K - 1 && n <= get_max_order());
+  return reinterpret_cast<const Graph*>(reinterpret_cast<const char*>(header) +
+                                        header->offsets[n]);
+}
+
+void GrowthSnapshot::read_level(int n, std::vector<Graph>& graphs) const {
+  const Graph* begin = get_graphs(n);
+  graphs.assign(begin, begin + get_count(n));
+  if (get_n() != Graph::N) {
+    for (Graph& g : graphs) g.canonicalize();
+    std::sort(graphs.begin(), graphs.end());
+  }
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "graph.h"
+
+// A binary file of the graphs collected by the growth phase, so that later runs of the same
+// problem can skip the growth and go straight to the final enumeration phase.
+//
+// The file of a problem with K and N holds the collected graphs of each order between K-1 and
+// N-1, in the order of Grower's collected_graphs[], as raw Graph structs, so it's read through a
+// read-only mmap without any parsing.
+//
+// The graphs are canonicalized under the N of the run that wrote the file. The graph hashes depend
+// on N, and so may the canonical labels, which come from a sort of the N vertices, so a run with
+// another N has to canonicalize the graphs again and sort them, see `read_level()`.
+class GrowthSnapshot {
+ public:
+  GrowthSnapshot() = default;
+  GrowthSnapshot(const GrowthSnapshot&) = delete;
+  GrowthSnapshot& operator=(const GrowthSnapshot&) = delete;
+  ~GrowthSnapshot() { close(); }
+
+  // Returns the path of the file of the given problem with the current K and the given N in the
+  // directory `dir`.
+  static std::string get_path(const std::string& dir, const std::string& problem, int n);
+
+  // Writes collected_graphs[K-1..N-1] into the file of the given problem with the current K and
+  // N in the directory `dir`. The file is replaced atomically. Returns true if successful.
+  static bool write(const std::string& dir, const std::string& problem,
+                    const GraphSpan collected_graphs[MAX_VERTICES]);
+
+  // Opens the file with the most levels usable by the current K and N, preferring the one of the
+  // current N, then the ones of larger N (which have all levels), then the ones of smaller N
+  // (which have the levels up to their N-1). Files of other problems or format versions are
+  // ignored. Returns false if there is none.
+  bool open(const std::string& dir, const std::string& problem);
+
+  // Unmaps the opened file, if any.
+  void close();
+
+  // Returns the N of the run that wrote the opened file.
+  int get_n() const { return header == nullptr ? 0 : header->n; }
+
+  // Returns the largest order of the graphs in the opened file usable by the current N.
+  int get_max_order() const { return std::min(get_n(), Graph::N) - 1; }
+
+  // Returns the graphs of order n in the opened file, where K-1 <= n <= get_max_order().
+  const Graph* get_graphs(int n) const;
+  size_t get_count(int n) const { return header->counts[n]; }
+
+  // Returns the graphs of order n in the mapping of the opened file, which stays valid until the
+  // file is closed. They are only canonical under the current N if get_n() is N.
+  GraphSpan get_level(int n) const { return GraphSpan(get_graphs(n), get_count(n)); }
+
+  // Copies the graphs of order n into `graphs`, canonicalizing them again if the file is from
+  // another N. They are then sorted again like grown graphs, so that each id is the same graph as
+  // in the levels grown with the current N.
+  void read_level(int n, std::vector<Graph>& graphs) const;
+
+ private:
+  // Changed whenever the layout of the file or of Graph changes.
+  static constexpr uint32 VERSION = 1;
+  static constexpr char MAGIC[8] = {'K', 'P', 'D', 'G', 'G', 'R', 'O', 'W'};
+  static constexpr int MAX_PROBLEM_LENGTH = 64;
+
+  // The header at the beginning of the file, followed by the graphs of each order. The offsets
+  // are in bytes from the beginning of the file.
+  struct Header {
+    char magic[8];
+    uint32 version;
+    uint32 graph_size;
+    uint32 k;
+    uint32 n;
+    char problem[MAX_PROBLEM_LENGTH];
+    uint64 counts[MAX_VERTICES];
+    uint64 offsets[MAX_VERTICES];
+  };
+
+  // Maps the given file, and checks that it's a valid file of the given problem with the current
+  // K. Returns false and unmaps it otherwise.
+  bool open_file(const std::string& path, const std::string& problem);
+
+  const Header* header = nullptr;
+  size_t mapped_size = 0;
+};
@@ -0,0 +1,200 @@
+#include "growth_spill.h"
+
+// The graphs are written as raw bytes.
+static_assert(std::is_trivially_copyable<Graph>::value);
+
+GrowthSpill::GrowthSpill(const std::string& dir, uint64 memory_budget_bytes, int threads_)
+    : max_run_graphs(std::max<uint64>(memory_budget_bytes / BYTES_PER_RUN_GRAPH, 1)),
+      threads(std::max(threads_, 1)),
+      max_sort_records(std::max<uint64>(memory_budget_bytes / threads / sizeof(Record), 1)) {
+  std::string dir_template = dir + "/growth_spill_XXXXXX";
+  if (mkdtemp(dir_template.data()) == nullptr) return;
+  temp_dir = dir_template;
+  for (int p = 0; p < PARTITIONS; p++) {
+    FILE* file = fopen(get_partition_path(p, ".raw").c_str(), "wb");
+    if (file == nullptr) {
+      for (FILE* f : files) fclose(f);
+      files.clear();
+      return;
+    }
+    files.push_back(file);
+  }
+}
+
+GrowthSpill::~GrowthSpill() {
+  for (FILE* file : files) fclose(file);
+  if (!temp_dir.empty()) std::filesystem::remove_all(temp_dir);
+}
+
+std::string GrowthSpill::get_partition_path(int partition, const std::string& suffix) const {
+  return temp_dir + "/" + std::to_string(partition) + suffix;
+}
+
+bool GrowthSpill::add(const Graph& g) {
+  // An isomorphic graph already in the run keeps its smaller sequence number.
+  run.emplace(g, next_sequence++);
+  return run.size() < max_run_graphs || write_run();
+}
+
+bool GrowthSpill::write_run() {
+  bool ok = true;
+  for (const auto& [graph, sequence] : run) {
+    const Record record{graph, sequence};
+    ok &= fwrite(&record, sizeof(record), 1, files[graph.get_graph_hash() % PARTITIONS]) == 1;
+  }
+  run.clear();
+  return ok;
+}
+
+bool GrowthSpill::sort_partition(int partition, const std::string& from, const std::string& to,
+                                 RecordLess less) const {
+  const std::string from_path = get_partition_path(partition, from);
+  std::vector<std::string> runs;
+  {
+    std::ifstream in(from_path, std::ios::binary);
+    std::vector<Record> records;
+    Record record;
+    do {
+      records.clear();
+      while (records.size() < max_sort_records &&
+             in.read(reinterpret_cast<char*>(&record), sizeof(record))) {
+        records.push_back(record);
+      }
+      std::sort(records.begin(), records.end(), less);
+      runs.push_back(get_partition_path(partition, to + ".run" + std::to_string(runs.size())));
+      std::ofstream out(runs.back(), std::ios::binary | std::ios::trunc);
+      out.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(Record));
+      out.flush();
+      if (!out) return false;
+    } while (in);
+    if (!in.eof()) return false;
+  }
+  std::remove(from_path.c_str());
+
+  for (int pass = 0; runs.size() > 1; pass++) {
+    std::vector<std::string> merged;
+    for (size_t i = 0; i < runs.size(); i += MAX_MERGE_FAN_IN) {
+      const std::vector<std::string> group(
+          runs.begin() + i, runs.begin() + std::min(i + MAX_MERGE_FAN_IN, runs.size()));
+      merged.push_back(get_partition_path(partition, to + ".merge" + std::to_string(pass) + "_" +
+                                                         std::to_string(merged.size())));
+      if (!merge_files(group, merged.back(), less)) return false;
+    }
+    runs.swap(merged);
+  }
+  return std::rename(runs[0].c_str(), get_partition_path(partition, to).c_str()) == 0;
+}
+
+bool GrowthSpill::merge_files(const std::vector<std::string>& inputs, const std::string& output,
+                              RecordLess less) {
+  std::vector<std::ifstream> files;
+  for (const std::string& path : inputs) files.emplace_back(path, std::ios::binary);
+  std::vector<Record> heads(inputs.size());
+  // The inputs with a record in `heads`, the smallest record on top.
+  auto greater = [&heads, less](int a, int b) { return less(heads[b], heads[a]); };
+  std::priority_queue<int, std::vector<int>, decltype(greater)> queue(greater);
+  auto read_head = [&files, &heads, &queue](int i) {
+    if (files[i].read(reinterpret_cast<char*>(&heads[i]), sizeof(Record))) queue.push(i);
+  };
+  for (size_t i = 0; i < inputs.size(); i++) read_head(i);
+  std::ofstream out(output, std::ios::binary | std::ios::trunc);
+  while (!queue.empty()) {
+    const int i = queue.top();
+    queue.pop();
+    out.write(reinterpret_cast<const char*>(&heads[i]), sizeof(Record));
+    read_head(i);
+  }
+  out.flush();
+  bool ok = static_cast<bool>(out);
+  for (size_t i = 0; i < inputs.size(); i++) {
+    ok &= files[i].eof();
+    std::remove(inputs[i].c_str());
+  }
+  return ok;
+}
+
+bool GrowthSpill::dedup_partition(int partition) const {
+  // The isomorphic graphs have the same graph hash, so sorting by the hash makes each class
+  // consecutive, and then by the sequence number puts first the graph to keep.
+  if (!sort_partition(partition, ".raw", ".by_hash", [](const Record& a, const Record& b) {
+        const uint32 hash_a = a.graph.get_graph_hash(), hash_b = b.graph.get_graph_hash();
+        return hash_a < hash_b || (hash_a == hash_b && a.sequence < b.sequence);
+      })) {
+    return false;
+  }
+  const std::string by_hash_path = get_partition_path(partition, ".by_hash");
+  {
+    std::ifstream in(by_hash_path, std::ios::binary);
+    std::ofstream out(get_partition_path(partition, ".kept"), std::ios::binary | std::ios::trunc);
+    // The graphs kept so far with the graph hash of the current record.
+    std::vector<Graph> kept;
+    Record record;
+    while (in.read(reinterpret_cast<char*>(&record), sizeof(record))) {
+      if (!kept.empty() && kept[0].get_graph_hash() != record.graph.get_graph_hash()) {
+        kept.clear();
+      }
+      if (std::any_of(kept.begin(), kept.end(),
+                      [&record](const Graph& g) { return g.is_isomorphic(record.graph); })) {
+        continue;
+      }
+      kept.push_back(record.graph);
+      out.write(reinterpret_cast<const char*>(&record), sizeof(record));
+    }
+    out.flush();
+    if (!in.eof() || !out) return false;
+  }
+  std::remove(by_hash_path.c_str());
+  return sort_partition(partition, ".kept", ".sorted",
+                        [](const Record& a, const Record& b) { return a.graph < b.graph; });
+}
+
+bool GrowthSpill::finish(std::vector<Graph>& result,
+                         const std::function<void(const Graph&, uint64 sequence)>& on_graph) {
+  bool ok = write_run();
+  // Release the buckets of the run, which the sorts below need.
+  decltype(run)().swap(run);
+  for (FILE* file : files) ok &= fclose(file) == 0;
+  files.clear();
+  if (!ok) return false;
+
+  // Deduplicate the partitions in parallel.
+  std::atomic<int> next_partition{0};
+  std::atomic<bool> failed{false};
+  auto dedup_partitions = [this, &next_partition, &failed] {
+    for (int p; (p = next_partition++) < PARTITIONS;) {
+      if (!dedup_partition(p)) failed = true;
+    }
+  };
+  std::vector<std::thread> dedup_threads;
+  for (int i = 1; i < threads; i++) dedup_threads.push_back(std::thread(dedup_partitions));
+  dedup_partitions();
+  for (std::thread& t : dedup_threads) t.join();
+  if (failed) return false;
+
+  // Merge the sorted partitions.
+  std::vector<std::ifstream> inputs;
+  uint64 total = 0;
+  for (int p = 0; p < PARTITIONS; p++) {
+    const std::string path = get_partition_path(p, ".sorted");
+    total += std::filesystem::file_size(path) / sizeof(Record);
+    inputs.emplace_back(path, std::ios::binary);
+  }
+  std::vector<Record> heads(PARTITIONS);
+  // The partitions with a record in `heads`, the smallest graph on top.
+  auto greater = [&heads](int a, int b) { return heads[b].graph < heads[a].graph; };
+  std::priority_queue<int, std::vector<int>, decltype(greater)> queue(greater);
+  auto read_head = [&inputs, &heads, &queue](int p) {
+    if (inputs[p].read(reinterpret_cast<char*>(&heads[p]), sizeof(Record))) queue.push(p);
+  };
+  for (int p = 0; p < PARTITIONS; p++) read_head(p);
+  result.clear();
+  result.reserve(total);
+  while (!queue.empty()) {
+    const int p = queue.top();
+    queue.pop();
+    result.push_back(heads[p].graph);
+    on_graph(heads[p].graph, heads[p].sequence);
+    read_head(p);
+  }
+  return result.size() == total;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "graph.h"
+
+// Deduplicates the canonical graphs of a growth step that don't fit in memory, by spilling them
+// to disk.
+//
+// The graphs are added in the order the growth step finds them. They are collected in an
+// in-memory hash set until it reaches the memory budget, which is then written as a run: each
+// graph goes to one of PARTITIONS partition files by its graph hash, which is invariant under
+// isomorphisms, so all the graphs of an isomorphism class end up in the same partition. Each
+// graph is written with its sequence number, the number of graphs added before it.
+//
+// finish() then deduplicates the partitions independently on multiple threads, keeping the
+// graph with the smallest sequence number of each isomorphism class, the same one an in-memory
+// hash set would keep, and sorts each partition. The sorted partitions are merged into the
+// sorted level. So the result is exactly the same as without spilling.
+//
+// The partitions are sorted on disk, so the memory used stays within the budget however many
+// duplicates were spilled: each thread of finish() sorts runs of at most its share of the budget
+// and merges them. Deduplicating a sorted partition only holds the graphs kept for the current
+// graph hash, like one bucket of a hash set. The deduplicated level returned by finish() is in
+// memory, as without spilling.
+class GrowthSpill {
+ public:
+  // Creates a temporary directory in `dir` for the partition files. The threads of finish()
+  // share the memory budget.
+  GrowthSpill(const std::string& dir, uint64 memory_budget_bytes, int threads);
+  GrowthSpill(const GrowthSpill&) = delete;
+  GrowthSpill& operator=(const GrowthSpill&) = delete;
+  // Removes the temporary directory.
+  ~GrowthSpill();
+
+  // Returns false if the temporary directory or the partition files can't be created.
+  bool is_open() const { return !files.empty(); }
+
+  // Adds the canonicalized graph. Returns false if writing the run fails.
+  bool add(const Graph& g);
+
+  // Deduplicates and sorts all graphs added, and stores one graph of each isomorphism class into
+  // `result` in the ascending order. Calls `on_graph` for each of them with its sequence number,
+  // in the same order on the calling thread. Returns false if reading or writing the partition
+  // files fails.
+  bool finish(std::vector<Graph>& result,
+              const std::function<void(const Graph&, uint64 sequence)>& on_graph);
+
+ private:
+  static constexpr int PARTITIONS = 64;
+  // The memory of each graph in the run, including the node and bucket of the hash map.
+  static constexpr uint64 BYTES_PER_RUN_GRAPH = sizeof(Graph) + 48;
+  // The most sorted runs merged at once when sorting a partition file.
+  static constexpr int MAX_MERGE_FAN_IN = 16;
+
+  // A graph in a partition file.
+  struct Record {
+    Graph graph;
+    uint64 sequence;
+  };
+  using RecordLess = bool (*)(const Record&, const Record&);
+
+  std::string temp_dir;
+  // The number of graphs the run holds before it's written.
+  const uint64 max_run_graphs;
+  const int threads;
+  // The number of records each thread of finish() sorts in memory.
+  const uint64 max_sort_records;
+  // The current run, mapping each graph to its sequence number.
+  std::unordered_map<Graph, uint64, GraphHasher, GraphComparer> run;
+  uint64 next_sequence = 0;
+  // The partition files being written.
+  std::vector<FILE*> files;
+
+  // Returns the path of the given partition file, with the given suffix.
+  std::string get_partition_path(int partition, const std::string& suffix) const;
+
+  // Writes the current run into the partition files. Returns false on error.
+  bool write_run();
+
+  // Sorts the records of the partition file with the suffix `from` by `less` into the one with
+  // the suffix `to`, and removes the former. At most max_sort_records records are in memory:
+  // the sorted runs of that many records are written, then merged MAX_MERGE_FAN_IN at a time.
+  // Returns false on error.
+  bool sort_partition(int partition, const std::string& from, const std::string& to,
+                      RecordLess less) const;
+
+  // Merges the sorted record files `inputs` into `output`, and removes them. Returns false on
+  // error.
+  static bool merge_files(const std::vector<std::string>& inputs, const std::string& output,
+                          RecordLess less);
+
+  // Replaces the partition file by its deduplicated and sorted records. Returns false on error.
+  bool dedup_partition(int partition) const;
+};
@@ -1,41 +1,196 @@
 #include "counters.h"
+#include "cpu_topology.h"
+#include "edge_gen.h"
 #include "forbid_tk/graph_tk.h"
 #include "graph.h"
 
+// The maximum number of worker threads.
+constexpr int MAX_THREADS = 128;
+
 void print_usage() {
-  std::cout << "Usage: kPDG K N T [start_idx, end_idx, [theta_n, theta_d]]\n"
+  std::cout << "Usage: kPDG [options] K N T [start_idx, end_idx, [theta_n, theta_d]]\n"
             << "  Each argument is an integer, K and N are required, others optional.\n"
             << "  K = Number of vertices in each edge.\n"
             << "  N = Total number of vertices in a graph.  2 <= K <= N <= 12.\n"
             << "  T = Number of worker threads. (0 means don't use threads,\n"
-            << "                                 -1 means no final phase).\n"
+            << "                                 -1 means no final phase,\n"
+            << "                                 auto means the number of CPUs available to\n"
+            << "                                 the process, within its cgroup CPU quota,\n"
+            << "                                 up to 128).\n"
             << "  (optional) start_idx and end_index: the range of graph indices in the final\n"
             << "    enumeration phase (inclusive on both ends), allowing the search to run on\n"
             << "    multiple computers independently. They must be both omitted or both included\n"
             << "    in the arguments. end_idx can be larger than number of graphs available.\n"
             << "  (optional) theta_n and theta_d: if specified, find all graphs that produce the\n"
             << "    given theta value and print into the result log, instead of searching for\n"
-            << "    the minimum theta value.\n";
+            << "    the minimum theta value.\n"
+            << "Options:\n"
+            << "  --order=ascending|constrained|adaptive : the order of the edge candidates in\n"
+            << "    the final enumeration phase (default ascending). \"constrained\" puts the\n"
+            << "    edge candidates forming T_k with more base graph edges at higher digits,\n"
+            << "    \"adaptive\" also reorders the lower digits by the observed T_k skips.\n"
+            << "    The min theta values are not affected, but the graphs producing them may be.\n"
+            << "  --min-degree : in the final enumeration phase, only generate the graphs where\n"
+            << "    the new vertex has the minimum degree. The min theta value is not affected,\n"
+            << "    but the min theta value of each base graph in the detail log may be larger.\n"
+            << "  --estimate=P : instead of the final enumeration phase, estimate the size of the\n"
+            << "    search tree of each base graph with P random probes, and print the estimates\n"
+            << "    with 95% confidence intervals into the console and the detail log.\n"
+            << "  --longest-first=P : estimate the cost of each base graph with P random probes\n"
+            << "    (see --estimate), and start the final enumeration of the expensive base\n"
+            << "    graphs first, so that the cheap ones balance the threads at the end.\n"
+            << "  --checkpoint=PATH : save the progress of the final enumeration phase into PATH\n"
+            << "    periodically, and when it completes or is stopped by SIGTERM. SIGTERM in the\n"
+            << "    growth phase stops before the next level without a checkpoint.\n"
+            << "  --checkpoint-interval=S : the number of seconds between the checkpoints\n"
+            << "    (default 600).\n"
+            << "  --resume : continue the final enumeration phase from the checkpoint, if it\n"
+            << "    exists. Requires --checkpoint, and the same K, N, --order, --min-degree,\n"
+            << "    --orderly and search mode.\n"
+            << "  --growth-snapshot=DIR : keep the graphs of the growth phase in a file in DIR,\n"
+            << "    and reuse them in the later runs of the same K instead of growing them\n"
+            << "    again.\n"
+            << "  --coordinator=ADDR : instead of the final enumeration phase, hand out the base\n"
+            << "    graphs between start_idx and end_idx to the worker processes connecting to\n"
+            << "    ADDR, and write their results into the logs. ADDR is the path of a UNIX\n"
+            << "    socket if it contains '/', or [HOST:]PORT of a TCP socket otherwise.\n"
+            << "  --worker=ADDR : in the final enumeration phase, process the base graphs handed\n"
+            << "    out by the coordinator at ADDR, which must have the same K, N, --order,\n"
+            << "    --min-degree and --orderly.\n"
+            << "  --pin=compact|scatter : pin the worker threads to the CPUs, filling one NUMA\n"
+            << "    node after another (compact) or spreading them across the nodes (scatter).\n"
+            << "    Each thread allocates its buffers on its own node.\n"
+            << "  --growth-spill=DIR : deduplicate the graphs of each growth step through\n"
+            << "    partition files in DIR, for the steps that don't fit in memory.\n"
+            << "  --growth-memory=MB : the memory for collecting and deduplicating the graphs of\n"
+            << "    a growth step with --growth-spill, besides the level kept (default 4096).\n"
+            << "  --orderly : generate each isomorphism class once in the growth phase by\n"
+            << "    canonical augmentation, on all worker threads, instead of deduplicating\n"
+            << "    through a hash set. The base graph ids differ from the default.\n";
+}
+
+// The values of the command line options.
+struct Options {
+  CandidateOrder candidate_order = CandidateOrder::ASCENDING;
+  bool min_degree_filter = false;
+  int estimate_probes = 0;
+  int longest_first_probes = 0;
+  std::string checkpoint_path;
+  int checkpoint_interval_seconds = 600;
+  bool resume = false;
+  std::string growth_snapshot_dir;
+  std::string coordinator_address;
+  std::string worker_address;
+  PlacementPolicy placement = PlacementPolicy::NONE;
+  std::string growth_spill_dir;
+  int growth_memory_mb = 4096;
+  bool orderly_generation = false;
+};
+
+// Parses the option in the form of "--name=value" or "--name". Returns false if the option is
+// unknown or invalid.
+bool parse_option(const std::string& option, Options& options) {
+  const std::string estimate_prefix = "--estimate=";
+  const std::string longest_first_prefix = "--longest-first=";
+  const std::string checkpoint_prefix = "--checkpoint=";
+  const std::string checkpoint_interval_prefix = "--checkpoint-interval=";
+  const std::string growth_snapshot_prefix = "--growth-snapshot=";
+  const std::string coordinator_prefix = "--coordinator=";
+  const std::string worker_prefix = "--worker=";
+  const std::string growth_spill_prefix = "--growth-spill=";
+  const std::string growth_memory_prefix = "--growth-memory=";
+  if (option == "--order=ascending") {
+    options.candidate_order = CandidateOrder::ASCENDING;
+  } else if (option == "--order=constrained") {
+    options.candidate_order = CandidateOrder::CONSTRAINED;
+  } else if (option == "--order=adaptive") {
+    options.candidate_order = CandidateOrder::ADAPTIVE;
+  } else if (option == "--min-degree") {
+    options.min_degree_filter = true;
+  } else if (option.compare(0, estimate_prefix.size(), estimate_prefix) == 0) {
+    options.estimate_probes = atoi(option.c_str() + estimate_prefix.size());
+    return options.estimate_probes > 0;
+  } else if (option.compare(0, longest_first_prefix.size(), longest_first_prefix) == 0) {
+    options.longest_first_probes = atoi(option.c_str() + longest_first_prefix.size());
+    return options.longest_first_probes > 0;
+  } else if (option.compare(0, checkpoint_prefix.size(), checkpoint_prefix) == 0) {
+    options.checkpoint_path = option.substr(checkpoint_prefix.size());
+    return !options.checkpoint_path.empty();
+  } else if (option.compare(0, checkpoint_interval_prefix.size(), checkpoint_interval_prefix) ==
+             0) {
+    options.checkpoint_interval_seconds = atoi(option.c_str() + checkpoint_interval_prefix.size());
+    return options.checkpoint_interval_seconds > 0;
+  } else if (option == "--resume") {
+    options.resume = true;
+  } else if (option.compare(0, growth_snapshot_prefix.size(), growth_snapshot_prefix) == 0) {
+    options.growth_snapshot_dir = option.substr(growth_snapshot_prefix.size());
+    return !options.growth_snapshot_dir.empty();
+  } else if (option.compare(0, coordinator_prefix.size(), coordinator_prefix) == 0) {
+    options.coordinator_address = option.substr(coordinator_prefix.size());
+    return !options.coordinator_address.empty();
+  } else if (option.compare(0, worker_prefix.size(), worker_prefix) == 0) {
+    options.worker_address = option.substr(worker_prefix.size());
+    return !options.worker_address.empty();
+  } else if (option.compare(0, growth_spill_prefix.size(), growth_spill_prefix) == 0) {
+    options.growth_spill_dir = option.substr(growth_spill_prefix.size());
+    return !options.growth_spill_dir.empty();
+  } else if (option.compare(0, growth_memory_prefix.size(), growth_memory_prefix) == 0) {
+    options.growth_memory_mb = atoi(option.c_str() + growth_memory_prefix.size());
+    return options.growth_memory_mb > 0;
+  } else if (option == "--orderly") {
+    options.orderly_generation = true;
+  } else if (option == "--pin=compact") {
+    options.placement = PlacementPolicy::COMPACT;
+  } else if (option == "--pin=scatter") {
+    options.placement = PlacementPolicy::SCATTER;
+  } else {
+    return false;
+  }
+  return true;
 }
 
 int main(int argc, char* argv[]) {
-  if (argc != 4 && argc != 6 && argc != 8) {
+  // Options start with "--" and can appear anywhere, the rest are positional arguments.
+  std::vector<char*> args;
+  Options options;
+  for (int i = 0; i < argc; i++) {
+    if (i > 0 && strncmp(argv[i], "--", 2) == 0) {
+      if (!parse_option(argv[i], options)) {
+        std::cout << "Unknown option " << argv[i] << ". See usage for details.\n";
+        print_usage();
+        return -1;
+      }
+    } else {
+      args.push_back(argv[i]);
+    }
+  }
+  const int arg_count = static_cast<int>(args.size());
+  const bool distributed = !options.coordinator_address.empty() || !options.worker_address.empty();
+  if ((arg_count != 4 && arg_count != 6 && arg_count != 8) ||
+      (options.resume && options.checkpoint_path.empty()) ||
+      (options.orderly_generation && !options.growth_spill_dir.empty()) ||
+      (!options.coordinator_address.empty() && !options.worker_address.empty()) ||
+      (distributed && (arg_count == 8 || options.estimate_probes > 0 ||
+                       !options.checkpoint_path.empty()))) {
     print_usage();
     return -1;
   }
-  int k = atoi(argv[1]);
-  int n = atoi(argv[2]);
-  int t = atoi(argv[3]);
+  int k = atoi(args[1]);
+  int n = atoi(args[2]);
+  // T=auto is clamped to the maximum T, while an explicit T above it is rejected below.
+  int t = strcmp(args[3], "auto") == 0
+              ? std::min(CpuTopology::detect().get_available_cpu_count(), MAX_THREADS)
+              : atoi(args[3]);
   int start_idx = 0, end_idx = 0;
   int theta_n = 0, theta_d = 1;
   bool search_theta_graphs = false;
-  if (argc >= 6) {
-    start_idx = atoi(argv[4]);
-    end_idx = atoi(argv[5]);
+  if (arg_count >= 6) {
+    start_idx = atoi(args[4]);
+    end_idx = atoi(args[5]);
   }
-  if (argc == 8) {
-    theta_n = atoi(argv[6]);
-    theta_d = atoi(argv[7]);
+  if (arg_count == 8) {
+    theta_n = atoi(args[6]);
+    theta_d = atoi(args[7]);
     search_theta_graphs = true;
   }
 
@@ -45,7 +200,8 @@ int main(int argc, char* argv[]) {
     t = 0;
   }
 
-  if (k < 2 || n > 12 || k > n || t < 0 || t > 128 || start_idx < 0 || end_idx < start_idx) {
+  if (k < 2 || n > 12 || k > n || t < 0 || t > MAX_THREADS || start_idx < 0 ||
+      end_idx < start_idx) {
     std::cout << "Invalid command line arguments. See usage for details.\n";
     print_usage();
     return -1;
@@ -61,8 +217,32 @@ int main(int argc, char* argv[]) {
                                t, search_theta_graphs, Fraction(theta_n, theta_d), true);
   GrowerTk s(t, skip_final_enum, true, true, start_idx, end_idx, search_theta_graphs,
              Fraction(theta_n, theta_d));
-  s.set_logging(Counters::log, Counters::log_detail, Counters::log_result);
+  s.set_logging(Counters::log, Counters::log_detail, Counters::log_result, Counters::log_perf);
+  s.set_candidate_order(options.candidate_order);
+  s.set_min_degree_filter(options.min_degree_filter);
+  s.set_estimate_probes(options.estimate_probes);
+  s.set_longest_first(options.longest_first_probes);
+  s.set_growth_snapshot(options.growth_snapshot_dir);
+  s.set_placement(options.placement);
+  s.set_orderly_generation(options.orderly_generation);
+  if (!options.growth_spill_dir.empty()) {
+    s.set_growth_spill(options.growth_spill_dir, options.growth_memory_mb * (1ULL << 20));
+  }
+  if (!options.coordinator_address.empty()) {
+    s.set_coordinator(options.coordinator_address);
+  } else if (!options.worker_address.empty()) {
+    s.set_worker(options.worker_address);
+  }
+  if (!options.checkpoint_path.empty()) {
+    s.set_checkpoint(options.checkpoint_path, options.checkpoint_interval_seconds, options.resume);
+    // Stop with a final checkpoint instead of being killed.
+    std::signal(SIGTERM, [](int) { GrowerBase::request_stop(); });
+  }
   s.grow();
+  if (s.is_interrupted()) {
+    Counters::close_logging();
+    return 1;
+  }
   Counters::print_done_message();
   Counters::close_logging();
   return 0;
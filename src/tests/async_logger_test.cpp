@@ -0,0 +1,38 @@
+#include "../async_logger.h"
+
+#include "gtest/gtest.h"
+
+TEST(AsyncLoggerTest, MultipleProducers) {
+  // Each record is written once, and the records of each thread are written in order.
+  constexpr int THREADS = 4;
+  constexpr int RECORDS = 10000;
+  std::vector<std::pair<int, int>> written;
+  int flushes = 0;
+  {
+    AsyncLogger<std::pair<int, int>> logger(
+        [&written](const std::pair<int, int>& record) { written.push_back(record); },
+        [&flushes] { ++flushes; });
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; t++) {
+      threads.emplace_back([&logger, t] {
+        for (int i = 0; i < RECORDS; i++) logger.push(std::make_pair(t, i));
+      });
+    }
+    for (std::thread& t : threads) t.join();
+  }
+  ASSERT_EQ(written.size(), THREADS * RECORDS);
+  std::vector<int> next(THREADS, 0);
+  for (const auto& [t, i] : written) {
+    EXPECT_EQ(i, next[t]);
+    next[t] = i + 1;
+  }
+  EXPECT_GT(flushes, 0);
+}
+
+TEST(AsyncLoggerTest, Empty) {
+  int writes = 0;
+  {
+    AsyncLogger<int> logger([&writes](int) { ++writes; }, [] {});
+  }
+  EXPECT_EQ(writes, 0);
+}
@@ -0,0 +1,74 @@
+#include "../coordinator.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using namespace testing;
+
+TEST(CoordinatorTest, HandOut) {
+  Graph::set_global_graph_info(2, 4);
+  for (std::string address :
+       {testing::TempDir() + "coordinator_test", std::string("127.0.0.1:0")}) {
+    Coordinator coordinator;
+    ASSERT_TRUE(coordinator.listen(address));
+    if (address.find('/') == std::string::npos) {
+      // Connect to the free port chosen by the system.
+      ASSERT_GT(coordinator.get_port(), 0);
+      address = "127.0.0.1:" + std::to_string(coordinator.get_port());
+    }
+    std::vector<Coordinator::Result> results;
+    std::thread server([&coordinator, &results] {
+      coordinator.serve("K=2 N=4", 3, 6,
+                        [&results](const Coordinator::Result& r) { results.push_back(r); });
+    });
+
+    // Worker 0 runs another search.
+    CoordinatorClient other;
+    EXPECT_FALSE(other.connect(address, "K=2 N=5"));
+
+    int id;
+    {
+      // Worker 1 dies with two ids handed out.
+      CoordinatorClient dead;
+      ASSERT_TRUE(dead.connect(address, "K=2 N=4"));
+      ASSERT_EQ(dead.request_job(id), CoordinatorClient::Reply::JOB);
+      EXPECT_EQ(id, 3);
+      ASSERT_EQ(dead.request_job(id), CoordinatorClient::Reply::JOB);
+      EXPECT_EQ(id, 4);
+    }
+
+    // Worker 2 gets the ids of worker 1 first.
+    CoordinatorClient worker;
+    ASSERT_TRUE(worker.connect(address, "K=2 N=4"));
+    std::vector<int> ids;
+    for (int i = 0; i < 4; i++) {
+      ASSERT_EQ(worker.request_job(id), CoordinatorClient::Reply::JOB);
+      ids.push_back(id);
+    }
+    EXPECT_THAT(ids, ElementsAre(3, 4, 5, 6));
+    EXPECT_EQ(worker.request_job(id), CoordinatorClient::Reply::WAIT);
+    Graph g;
+    ASSERT_TRUE(Graph::parse_edges("{01, 12>2}", g));
+    for (int i : ids) EXPECT_TRUE(worker.send_result(i, Fraction(i, 2), g));
+    server.join();
+    // The coordinator closes the connections when all results are received.
+    EXPECT_EQ(worker.request_job(id), CoordinatorClient::Reply::DONE);
+
+    ASSERT_EQ(results.size(), 4);
+    for (size_t i = 0; i < results.size(); i++) {
+      EXPECT_EQ(results[i].base_graph_id, ids[i]);
+      EXPECT_EQ(results[i].min_ratio, Fraction(ids[i], 2));
+      EXPECT_EQ(results[i].min_ratio_graph.serialize_edges(), g.serialize_edges());
+      EXPECT_EQ(results[i].worker_id, 2);
+    }
+  }
+}
+
+TEST(CoordinatorTest, EmptyRange) {
+  // The start index may be past the last base graph, in which case there is nothing to serve.
+  Coordinator coordinator;
+  ASSERT_TRUE(coordinator.listen("127.0.0.1:0"));
+  int calls = 0;
+  coordinator.serve("K=2 N=4", 7, 6, [&calls](const Coordinator::Result&) { calls++; });
+  EXPECT_EQ(calls, 0);
+}
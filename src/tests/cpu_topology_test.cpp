@@ -0,0 +1,80 @@
+#include "../cpu_topology.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using namespace testing;
+
+TEST(CpuTopologyTest, WorkerCpu) {
+  // CPUs 0-3 on node 0 and 4-5 on node 1.
+  const CpuTopology topology({0, 1, 2, 3, 4, 5}, {0, 0, 0, 0, 1, 1}, 0);
+  EXPECT_EQ(topology.get_node_count(), 2);
+  EXPECT_EQ(topology.get_available_cpu_count(), 6);
+  std::vector<int> compact, scatter;
+  for (int i = 0; i < 8; i++) {
+    compact.push_back(topology.get_worker_cpu(PlacementPolicy::COMPACT, i));
+    scatter.push_back(topology.get_worker_cpu(PlacementPolicy::SCATTER, i));
+  }
+  EXPECT_THAT(compact, ElementsAre(0, 1, 2, 3, 4, 5, 0, 1));
+  EXPECT_THAT(scatter, ElementsAre(0, 4, 1, 5, 2, 3, 0, 4));
+
+  EXPECT_EQ(CpuTopology({0, 1, 2, 3}, {0, 0, 0, 0}, 1.5).get_available_cpu_count(), 2);
+  EXPECT_EQ(CpuTopology({0, 1}, {0, 0}, 8).get_available_cpu_count(), 2);
+}
+
+TEST(CpuTopologyTest, Detect) {
+  const std::string root = testing::TempDir() + "cpu_topology_test";
+  std::filesystem::remove_all(root);
+  auto write = [&root](const std::string& path, const std::string& text) {
+    std::filesystem::create_directories(std::filesystem::path(root + path).parent_path());
+    std::ofstream(root + path) << text;
+  };
+
+  // No sysfs: a single node and no quota.
+  const int cpu_count = CpuTopology::detect(root).get_available_cpu_count();
+  EXPECT_GE(cpu_count, 1);
+  EXPECT_EQ(CpuTopology::detect(root).get_node_count(), 1);
+
+  // cgroup v1 without a quota, then with a quota of half a CPU.
+  write("/fs/cgroup/cpu/cpu.cfs_quota_us", "-1\n");
+  write("/fs/cgroup/cpu/cpu.cfs_period_us", "100000\n");
+  EXPECT_EQ(CpuTopology::detect(root).get_available_cpu_count(), cpu_count);
+  write("/fs/cgroup/cpu/cpu.cfs_quota_us", "50000\n");
+  EXPECT_EQ(CpuTopology::detect(root).get_available_cpu_count(), 1);
+
+  // The quota of the process's own cgroup v1 counts.
+  const std::string proc_root = root + "/proc";
+  write("/proc/self/cgroup", "4:memory:/other\n3:cpu,cpuacct:/a/b\n");
+  write("/fs/cgroup/cpu/cpu.cfs_quota_us", "-1\n");
+  write("/fs/cgroup/cpu/a/b/cpu.cfs_quota_us", "50000\n");
+  write("/fs/cgroup/cpu/a/b/cpu.cfs_period_us", "100000\n");
+  EXPECT_EQ(CpuTopology::detect(root, proc_root).get_available_cpu_count(), 1);
+  EXPECT_EQ(CpuTopology::detect(root).get_available_cpu_count(), cpu_count);
+
+  // cgroup v2 takes precedence.
+  write("/fs/cgroup/cpu.max", "max 100000\n");
+  EXPECT_EQ(CpuTopology::detect(root).get_available_cpu_count(), cpu_count);
+  write("/fs/cgroup/cpu.max", "100000 100000\n");
+  EXPECT_EQ(CpuTopology::detect(root).get_available_cpu_count(), 1);
+
+  // The quota of the process's own cgroup v2 or of an ancestor counts, and a missing cgroup
+  // directory falls back to its ancestors.
+  write("/fs/cgroup/cpu.max", "max 100000\n");
+  write("/proc/self/cgroup", "0::/c/d\n");
+  write("/fs/cgroup/c/d/cpu.max", "max 100000\n");
+  EXPECT_EQ(CpuTopology::detect(root, proc_root).get_available_cpu_count(), cpu_count);
+  write("/fs/cgroup/c/cpu.max", "50000 100000\n");
+  EXPECT_EQ(CpuTopology::detect(root, proc_root).get_available_cpu_count(), 1);
+  write("/proc/self/cgroup", "0::/c/e\n");
+  EXPECT_EQ(CpuTopology::detect(root, proc_root).get_available_cpu_count(), 1);
+  write("/fs/cgroup/cpu.max", "100000 100000\n");
+
+  // The nodes without allowed CPUs don't count.
+  write("/devices/system/node/node0/cpulist", "1024-1100\n");
+  write("/devices/system/node/node1/cpulist", "0-1023\n");
+  const CpuTopology topology = CpuTopology::detect(root);
+  EXPECT_EQ(topology.get_node_count(), 1);
+  EXPECT_EQ(topology.get_worker_cpu(PlacementPolicy::SCATTER, 0),
+            topology.get_worker_cpu(PlacementPolicy::COMPACT, 0));
+  std::filesystem::remove_all(root);
+}
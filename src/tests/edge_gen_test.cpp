@@ -487,9 +487,34 @@ TEST(EdgeGeneratorTest, MinTheta3) {
   EXPECT_EQ(copy.serialize_edges(), "{012>2, 013>3, 023>3}");
 
   // Next should be "{012>2, 123}". But it doesn't produce smaller theta. So it should skip some,
-  // to get two directed edges.
+  // to get enough undirected edges.
   EXPECT_TRUE(edge_gen.next(copy, true, Fraction(3, 2)));
-  EXPECT_EQ(copy.serialize_edges(), "{012>2, 013>0, 023>0, 123}");
+  EXPECT_EQ(copy.serialize_edges(), "{012>2, 013, 023, 123}");
+
+  // Generate the next one, doesn't skip anything.
+  EXPECT_TRUE(edge_gen.next(copy, true, Fraction(3, 2)));
+  EXPECT_EQ(copy.serialize_edges(), "{012>2, 013>0, 023, 123}");
+}
+
+TEST(EdgeGeneratorTest, MinZeta) {
+  Graph::set_global_graph_info(2, 3);
+  Graph base;
+  EXPECT_TRUE(Graph::parse_edges("{01}", base));
+  EdgeCandidates ec(3);
+  EdgeGenerator edge_gen(ec, base);
+  edge_gen.set_ratio_bound(&Graph::get_zeta_ratio_bound);
+
+  Graph copy;
+  // Given that the known min_zeta is 3/2, if we add one edge to the new graph, it won't produce
+  // a smaller zeta even if it's undirected, so it should have two new edges. Unlike theta, the
+  // bound doesn't depend on the directed edges, so all graphs with two new edges are generated.
+  EXPECT_TRUE(edge_gen.next(copy, true, Fraction(3, 2)));
+  EXPECT_EQ(copy.serialize_edges(), "{01, 02, 12}");
+  for (int i = 0; i < 8; i++) {
+    EXPECT_TRUE(edge_gen.next(copy, true, Fraction(3, 2)));
+    EXPECT_EQ(copy.get_edge_count(), 3);
+  }
+  EXPECT_FALSE(edge_gen.next(copy, true, Fraction(3, 2)));
 }
 
 TEST(EdgeGeneratorTest, Stats) {
@@ -512,3 +537,315 @@ TEST(EdgeGeneratorTest, Stats) {
   EXPECT_TRUE(edge_gen.next(copy));
   EXPECT_EQ(edge_gen.stats_edge_sets, 1);
 }
+
+// Enumerates the given prefix range of the base graph, and returns the serialized graphs.
+// If use_opt is true, only the graphs with theta < 2 are returned, because the graphs skipped by
+// the min_theta optimization depend on where the enumeration starts.
+std::vector<std::string> enumerate_range(const EdgeCandidates& ec, const Graph& base, bool use_opt,
+                                         int prefix_digits, uint32 begin, uint32 end) {
+  EnumRange range(begin, end);
+  EdgeGenerator edge_gen(ec, base);
+  edge_gen.restrict_to_range(prefix_digits, &range);
+  std::vector<std::string> result;
+  Graph copy;
+  while (edge_gen.next(copy, use_opt, Fraction(2, 1))) {
+    if (!use_opt || copy.get_theta_ratio() < Fraction(2, 1)) {
+      result.push_back(copy.serialize_edges());
+    }
+  }
+  return result;
+}
+
+TEST(EdgeGeneratorTest, RestrictToRange) {
+  Graph::set_global_graph_info(2, 5);
+  Graph base;
+  EXPECT_TRUE(Graph::parse_edges("{01>0, 02, 13>1}", base));
+  EdgeCandidates ec(5);
+  EXPECT_EQ(EdgeGenerator::get_prefix_count(2), 16);
+
+  for (bool use_opt : {false, true}) {
+    const std::vector<std::string> all = enumerate_range(ec, base, use_opt, 0, 0, 1);
+    EXPECT_GT(all.size(), 0);
+
+    // The concatenation of consecutive ranges is the same as the full enumeration.
+    for (int prefix_digits = 1; prefix_digits <= 3; prefix_digits++) {
+      uint32 count = EdgeGenerator::get_prefix_count(prefix_digits);
+      for (uint32 mid = 1; mid < count; mid++) {
+        std::vector<std::string> result =
+            enumerate_range(ec, base, use_opt, prefix_digits, 0, mid);
+        std::vector<std::string> upper =
+            enumerate_range(ec, base, use_opt, prefix_digits, mid, count);
+        result.insert(result.end(), upper.begin(), upper.end());
+        EXPECT_EQ(result, all);
+      }
+    }
+  }
+}
+TEST(EdgeGeneratorTest, StealHalf) {
+  EnumRange range(0, 10);
+  EXPECT_EQ(range.remaining(), 9);
+  EXPECT_TRUE(range.enter(0));
+  EXPECT_TRUE(range.enter(3));
+  EXPECT_EQ(range.remaining(), 6);
+
+  // Prefixes 4..9 are not entered yet, steal the upper half.
+  uint32 begin, end;
+  EXPECT_TRUE(range.steal_half(begin, end));
+  EXPECT_EQ(begin, 7);
+  EXPECT_EQ(end, 10);
+  EXPECT_EQ(range.remaining(), 3);
+  EXPECT_TRUE(range.enter(6));
+  EXPECT_FALSE(range.enter(7));
+
+  // Nothing left to steal when the current prefix is the last one.
+  EnumRange last(5, 6);
+  EXPECT_FALSE(last.steal_half(begin, end));
+  EXPECT_FALSE(range.steal_half(begin, end));
+}
+
+// Enumerates all graphs from the base graph using the given candidate order, and returns the
+// serialized graphs in sorted order. With min_theta optimization, only the graphs with
+// theta < 5 are returned. With the T_k filter, the edge generator itself skips the graphs
+// containing T_k.
+std::vector<std::string> enumerate_sorted(const EdgeCandidates& ec, const Graph& base,
+                                          CandidateOrder order, bool use_opt,
+                                          bool tk_filter = false) {
+  EdgeGenerator edge_gen(ec, base);
+  edge_gen.set_candidate_order(order);
+  edge_gen.set_Tk_filter(tk_filter);
+  std::vector<std::string> result;
+  Graph copy;
+  while (edge_gen.next(copy, use_opt, Fraction(5, 1))) {
+    if (contains_Tk(copy, ec.n - 1)) {
+      EXPECT_FALSE(tk_filter);
+      edge_gen.notify_contain_tk_skip();
+      continue;
+    }
+    if (!use_opt || copy.get_theta_ratio() < Fraction(5, 1)) {
+      copy.canonicalize();
+      result.push_back(copy.serialize_edges());
+    }
+  }
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+TEST(EdgeGeneratorTest, CandidateOrder) {
+  // There are 7 edge candidates, enough to trigger the reordering in adaptive order.
+  Graph::set_global_graph_info(2, 8);
+  Graph base;
+  EXPECT_TRUE(Graph::parse_edges("{01>0, 02, 12, 13>1, 34>4, 45, 56>6}", base));
+  EdgeCandidates ec(8);
+
+  // The same T_k-free graphs are generated regardless of the candidate order.
+  for (bool use_opt : {false, true}) {
+    const std::vector<std::string> expected =
+        enumerate_sorted(ec, base, CandidateOrder::ASCENDING, use_opt);
+    EXPECT_GT(expected.size(), 0);
+    EXPECT_EQ(enumerate_sorted(ec, base, CandidateOrder::CONSTRAINED, use_opt), expected);
+    EXPECT_EQ(enumerate_sorted(ec, base, CandidateOrder::ADAPTIVE, use_opt), expected);
+  }
+
+  // Edge {67} can only form T_2 with base edge {56}, while the other edge candidates can form
+  // T_2 with at least 2 base edges. So it's the least constrained, and is the lowest digit.
+  EdgeGenerator edge_gen(ec, base);
+  edge_gen.set_candidate_order(CandidateOrder::CONSTRAINED);
+  Graph copy;
+  EXPECT_TRUE(edge_gen.next(copy));
+  EXPECT_EQ(copy.serialize_edges(), "{01>0, 02, 12, 13>1, 34>4, 45, 56>6, 67}");
+}
+
+TEST(EdgeGeneratorTest, TkTriples) {
+  Graph::set_global_graph_info(3, 5);
+  EdgeCandidates ec(5);
+  // Edge candidates: {014, 024, 124, 034, 134, 234}.
+  EXPECT_EQ(ec.edge_candidate_count, 6);
+  EXPECT_EQ(ec.edge_candidates[0], 0b10011);
+  // With U={0,1,2,4}, edge {014} forms T_3 with {024} and {124}, stem {4} and triangle {0,1,2}.
+  // With U={0,1,3,4}, it forms T_3 with {034} and {134}.
+  ASSERT_EQ(ec.tk_triples[0].size(), 2);
+  EXPECT_EQ(ec.tk_triples[0][0].others, 0b000110);
+  EXPECT_EQ(ec.tk_triples[0][0].triangle, 0b0111);
+  EXPECT_EQ(ec.tk_triples[0][1].others, 0b011000);
+  EXPECT_EQ(ec.tk_triples[0][1].triangle, 0b1011);
+
+  // No triples for K=2, since the stem is empty.
+  Graph::set_global_graph_info(2, 5);
+  EdgeCandidates ec2(5);
+  EXPECT_TRUE(ec2.tk_triples[0].empty());
+}
+
+TEST(EdgeGeneratorTest, TkFilter) {
+  // The T_k filter generates the same T_k-free graphs as checking T_k on each returned graph.
+  std::vector<std::tuple<int, int, std::string>> cases = {
+      {2, 8, "{01>0, 02, 12, 13>1, 34>4, 45, 56>6}"},
+      {2, 6, "{01, 02>2, 03, 14>4}"},
+      {3, 6, "{012, 013>1, 024>4, 123, 234>2}"},
+      {4, 6, "{0123, 0124>1, 1234>2}"},
+  };
+  for (const auto& [k, n, edges] : cases) {
+    Graph::set_global_graph_info(k, n);
+    Graph base;
+    EXPECT_TRUE(Graph::parse_edges(edges, base));
+    EdgeCandidates ec(n);
+    for (bool use_opt : {false, true}) {
+      for (CandidateOrder order : {CandidateOrder::ASCENDING, CandidateOrder::ADAPTIVE}) {
+        const std::vector<std::string> expected = enumerate_sorted(ec, base, order, use_opt);
+        EXPECT_GT(expected.size(), 0);
+        EXPECT_EQ(enumerate_sorted(ec, base, order, use_opt, true), expected);
+      }
+    }
+  }
+}
+
+// Enumerates the T_k-free graphs from the base graph with next_batch() of the given batch size,
+// and returns the serialized graphs in the enumeration order.
+std::vector<std::string> enumerate_batches(const EdgeCandidates& ec, const Graph& base,
+                                           bool use_opt, int batch_size) {
+  EdgeGenerator edge_gen(ec, base);
+  edge_gen.set_candidate_order(CandidateOrder::ADAPTIVE);
+  std::vector<std::string> result;
+  Graph batch[EDGE_GEN_BATCH_SIZE];
+  int count;
+  while ((count = edge_gen.next_batch(batch, batch_size, use_opt, Fraction(5, 1))) > 0) {
+    for (int i = 0; i < count; i++) {
+      if (contains_Tk(batch[i], ec.n - 1)) {
+        edge_gen.rewind_batch(i);
+        edge_gen.notify_contain_tk_skip();
+        break;
+      }
+      result.push_back(batch[i].serialize_edges());
+    }
+  }
+  return result;
+}
+
+TEST(EdgeGeneratorTest, NextBatch) {
+  Graph::set_global_graph_info(2, 8);
+  Graph base;
+  EXPECT_TRUE(Graph::parse_edges("{01>0, 02, 12, 13>1, 34>4, 45, 56>6}", base));
+  EdgeCandidates ec(8);
+
+  // Batches of size 1 are the same as calling next(). The skips at batch boundaries generate
+  // the same graphs in the same order, including the reordering of the adaptive order.
+  for (bool use_opt : {false, true}) {
+    const std::vector<std::string> expected = enumerate_batches(ec, base, use_opt, 1);
+    EXPECT_GT(expected.size(), 0);
+    EXPECT_EQ(enumerate_batches(ec, base, use_opt, 5), expected);
+    EXPECT_EQ(enumerate_batches(ec, base, use_opt, EDGE_GEN_BATCH_SIZE), expected);
+  }
+}
+
+TEST(EdgeGeneratorTest, ProbeSearchTree) {
+  Graph::set_global_graph_info(2, 5);
+  Graph base;
+  EXPECT_TRUE(Graph::parse_edges("{01>0, 02, 13>1}", base));
+  EdgeCandidates ec(5);
+  EdgeGenerator edge_gen(ec, base);
+  std::mt19937 rng(0);
+  double estimate;
+  Graph leaf;
+
+  // Without pruning, every node has K+2 children, so every probe gives the exact tree size
+  // 1 + 4 + 4^2 + 4^3 + 4^4.
+  auto never = [](Graph&) { return false; };
+  for (int p = 0; p < 10; p++) {
+    edge_gen.probe_search_tree(rng, Fraction::infinity(), never, estimate, leaf);
+    EXPECT_EQ(estimate, 341);
+  }
+
+  // With pruning, the tree is smaller, and the leaves are T_k-free with theta below the bound.
+  auto contains = [](Graph& g) { return contains_Tk(g, Graph::N - 1); };
+  int leaf_count = 0;
+  for (int p = 0; p < 10; p++) {
+    if (edge_gen.probe_search_tree(rng, Fraction(3, 1), contains, estimate, leaf)) {
+      ++leaf_count;
+      EXPECT_FALSE(contains_Tk(leaf, Graph::N - 1));
+      EXPECT_LT(leaf.get_theta_ratio(), Fraction(3, 1));
+    }
+    EXPECT_LT(estimate, 341);
+  }
+  EXPECT_GT(leaf_count, 0);
+}
+
+// Returns true if vertex n-1 has the minimum degree in the graph, using its serialized edges.
+bool new_vertex_has_min_degree(const Graph& g, int n) {
+  int degree[MAX_VERTICES] = {0};
+  bool in_head = false;
+  for (char c : g.serialize_edges()) {
+    if (c == '>') in_head = true;
+    if (c == ',' || c == '}') in_head = false;
+    if (c >= '0' && c <= '9' && !in_head) ++degree[c - '0'];
+  }
+  return std::all_of(degree, degree + n - 1, [&](int d) { return degree[n - 1] <= d; });
+}
+
+TEST(EdgeGeneratorTest, MinDegreeFilter) {
+  Graph::set_global_graph_info(2, 7);
+  Graph base;
+  EXPECT_TRUE(Graph::parse_edges("{01>0, 02, 13>1, 34>4, 45, 35>3}", base));
+  EdgeCandidates ec(7);
+
+  // The filter returns exactly the T_k-free graphs where vertex 6 has the minimum degree, in the
+  // same order, and skips the others without returning them.
+  for (bool use_opt : {false, true}) {
+    std::vector<std::string> expected;
+    EdgeGenerator edge_gen(ec, base);
+    Graph copy;
+    while (edge_gen.next(copy, use_opt, Fraction(5, 1))) {
+      if (contains_Tk(copy, 6)) {
+        edge_gen.notify_contain_tk_skip();
+      } else if (new_vertex_has_min_degree(copy, 7)) {
+        expected.push_back(copy.serialize_edges());
+      }
+    }
+    EXPECT_GT(expected.size(), 0);
+
+    std::vector<std::string> result;
+    EdgeGenerator filtered_gen(ec, base);
+    filtered_gen.set_min_degree_filter(true);
+    while (filtered_gen.next(copy, use_opt, Fraction(5, 1))) {
+      EXPECT_TRUE(new_vertex_has_min_degree(copy, 7));
+      if (contains_Tk(copy, 6)) {
+        filtered_gen.notify_contain_tk_skip();
+      } else {
+        result.push_back(copy.serialize_edges());
+      }
+    }
+    EXPECT_EQ(result, expected);
+    EXPECT_LT(filtered_gen.stats_edge_sets, edge_gen.stats_edge_sets);
+  }
+}
+
+TEST(EdgeGeneratorTest, ChangedEdge) {
+  // When the edge generator reports the changed edge, only T_k with the changed edge needs to be
+  // checked. Also T_k with vertex N-1 is found through one of the edges of the new vertex.
+  std::vector<std::tuple<int, int, std::string>> cases = {
+      {2, 6, "{01>0, 02, 13>1, 34>4}"}, {3, 6, "{012, 013>3, 124>4, 234}"}};
+  for (const auto& [k, n, base_text] : cases) {
+    Graph::set_global_graph_info(k, n);
+    Graph base;
+    EXPECT_TRUE(Graph::parse_edges(base_text, base));
+    EdgeCandidates ec(n);
+    EdgeGenerator edge_gen(ec, base);
+    Graph copy;
+    int graph_count = 0;
+    int changed_count = 0;
+    while (edge_gen.next(copy)) {
+      ++graph_count;
+      const bool contains = contains_Tk(copy, n - 1);
+      bool contains_with_edge = false;
+      for (int c = 0; c < ec.edge_candidate_count; c++) {
+        contains_with_edge |= contains_Tk_with_edge(copy, ec.edge_candidates[c]);
+      }
+      EXPECT_EQ(contains_with_edge, contains);
+      const uint16 edge = edge_gen.get_changed_edge();
+      if (edge != 0) {
+        ++changed_count;
+        EXPECT_EQ(contains_Tk_with_edge(copy, edge), contains);
+      }
+      if (contains) edge_gen.notify_contain_tk_skip();
+    }
+    EXPECT_GT(changed_count, graph_count / 8);
+  }
+}
@@ -1,6 +1,7 @@
 #include "../graph.h"
 
 #include "../counters.h"
+#include "../forbid_tk/graph_tk.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "iso_stress_test.h"
@@ -330,6 +331,49 @@ TEST(GraphTest, Isomorphic_C) {
   EXPECT_TRUE(h.is_isomorphic(g));
 }
 
+TEST(GraphTest, CanonicalAugmentation) {
+  Graph::set_global_graph_info(2, 5);
+  // Deleting the middle vertex of the path leaves no edge.
+  EXPECT_TRUE(parse_edges("{01, 12}").is_canonical_augmentation(3));
+  EXPECT_FALSE(parse_edges("{02, 12}").is_canonical_augmentation(3));
+  // Vertex 3 is isolated.
+  EXPECT_FALSE(parse_edges("{01, 12}").is_canonical_augmentation(4));
+
+  // For every labeling of the graph, the last vertex is accepted iff it's in one orbit.
+  const std::vector<Edge> edges = {Edge(0b00011, 0), Edge(0b00110, UNDIRECTED),
+                                   Edge(0b01100, 3), Edge(0b11000, UNDIRECTED),
+                                   Edge(0b10001, 4), Edge(0b00101, 2)};
+  // Returns the graph with vertex v relabeled as p[v], without the edges of vertex `deleted`.
+  auto relabel = [&edges](const int p[], int deleted) {
+    Graph g;
+    for (const Edge& e : edges) {
+      if ((e.vertex_set & (1 << deleted)) != 0) continue;
+      uint16 vertex_set = 0;
+      for (int v = 0; v < 5; v++) {
+        if ((e.vertex_set & (1 << v)) != 0) vertex_set |= 1 << p[v];
+      }
+      g.add_edge(Edge(vertex_set, e.head_vertex == UNDIRECTED ? UNDIRECTED : p[e.head_vertex]));
+    }
+    return g;
+  };
+  int p[5] = {0, 1, 2, 3, 4};
+  std::map<int, std::set<bool>> accepted;
+  do {
+    const int last = std::find(p, p + 5, 4) - p;
+    accepted[last].insert(relabel(p, -1).is_canonical_augmentation(5));
+  } while (std::next_permutation(p, p + 5));
+  std::vector<Graph> parents;
+  for (const auto& [v, results] : accepted) {
+    ASSERT_EQ(results.size(), 1);
+    if (*results.begin()) {
+      parents.push_back(relabel(p, v));
+      parents.back().canonicalize();
+    }
+  }
+  ASSERT_FALSE(parents.empty());
+  for (const Graph& g : parents) EXPECT_TRUE(g.is_isomorphic(parents[0]));
+}
+
 TEST(GraphTest, Theta) {
   Graph g = get_T3();
   EXPECT_EQ(g.get_theta_ratio(), Fraction(4, 1));
@@ -427,4 +471,41 @@ TEST(GraphTest, CountersInit) {
   EXPECT_EQ(Counters::fmt(12345678901234567ULL), "12345`678901`234567");
   Counters::print_done_message();
   Counters::close_logging();
-}
\ No newline at end of file
+}
+TEST(GraphTest, ContainsTkTables) {
+  // contains_Tk() with the precomputed T_k tables agrees with contains_Tk_slow() on random graphs.
+  std::mt19937 rng(0);
+  for (int k = 2; k <= 5; k++) {
+    for (int n = k + 1; n <= 8; n++) {
+      Graph::set_global_graph_info(k, n);
+      if (Graph::TOTAL_EDGES > MAX_EDGES) continue;
+      int contains_count = 0;
+      int total_count = 0;
+      for (int iter = 0; iter < 400; iter++) {
+        // Each edge is present with probability between 1/8 and 1/2, and then directed with
+        // probability 1/4.
+        Graph g;
+        for (int r = 0; r < Graph::TOTAL_EDGES; r++) {
+          if (static_cast<int>(rng() % 8) > iter % 4) continue;
+          Edge e;
+          e.vertex_set = Graph::VERTEX_MASKS[k].masks[r];
+          e.head_vertex = UNDIRECTED;
+          if (rng() % 4 == 0) {
+            uint16 bits = e.vertex_set;
+            for (int skip = rng() % k; skip > 0; skip--) bits &= bits - 1;
+            e.head_vertex = __builtin_ctz(bits);
+          }
+          g.add_edge(e);
+        }
+        for (int v = 0; v < n; v++) {
+          const bool contains = contains_Tk_slow(g, v);
+          EXPECT_EQ(contains_Tk(g, v), contains);
+          contains_count += contains;
+          ++total_count;
+        }
+      }
+      EXPECT_GT(contains_count, 0);
+      EXPECT_LT(contains_count, total_count);
+    }
+  }
+}
@@ -1,3 +1,5 @@
+#include <sys/wait.h>
+
 #include "../counters.h"
 #include "../forbid_tk/graph_tk.h"
 #include "../graph.h"
@@ -15,8 +17,11 @@ void verify_array_equal(const std::vector<std::tuple<int, Graph, Graph>>& a,
   }
 }
 
-void verify_growth_result(int k, int n, Fraction min_theta, const std::string& min_theta_graph,
-                          int num_threads) {
+// If single_thread_results is not nullptr, the results are stored into it when num_threads == 0,
+// otherwise the results are verified against it.
+void verify_growth_result(
+    int k, int n, Fraction min_theta, const std::string& min_theta_graph, int num_threads,
+    std::vector<std::tuple<int, Graph, Graph>>* single_thread_results = nullptr) {
   Graph::set_global_graph_info(k, n);
   Counters::initialize();
   GrowerTk s1(num_threads, false, false, false, 0, 0);
@@ -55,14 +60,22 @@ void verify_growth_result(int k, int n, Fraction min_theta, const std::string& m
     verify_array_equal(s1.get_results(), s2.get_results());
     verify_array_equal(s1.get_results(), s3.get_results());
     verify_array_equal(s1.get_results(), s4.get_results());
+    if (single_thread_results != nullptr) {
+      *single_thread_results = s4.get_results();
+    }
+  } else if (single_thread_results != nullptr) {
+    // A base graph may be split across threads, but its result must still be exactly the same
+    // as in the single-threaded run.
+    verify_array_equal(*single_thread_results, s4.get_results());
   }
 }
 
 void verify_growth_result_various_threads(int k, int n, Fraction min_theta,
                                           const std::string& min_theta_graph) {
   Graph::set_global_graph_info(k, n);
+  std::vector<std::tuple<int, Graph, Graph>> single_thread_results;
   for (int num_threads = 0; num_threads < 10; num_threads++) {
-    verify_growth_result(k, n, min_theta, min_theta_graph, num_threads);
+    verify_growth_result(k, n, min_theta, min_theta_graph, num_threads, &single_thread_results);
   }
 }
 
@@ -131,7 +144,7 @@ TEST(GrowerTest, WithLogging) {
     Counters::initialize();
     GrowerTk s1(2, false, false, false, 0, 0, false, Fraction(1E8, 1));
     s1.set_logging(&log, &log_detail, &log_result);
-    s1.set_stats_print_interval(1, 0);
+    s1.set_stats_print_interval(0);
     s1.grow();
     EXPECT_EQ(Counters::get_min_ratio(), Fraction(3, 2));
   }
@@ -140,7 +153,7 @@ TEST(GrowerTest, WithLogging) {
     Counters::initialize();
     GrowerTk s1(2, false, false, false, 0, 0, true, Fraction(3, 2));
     s1.set_logging(&log, nullptr, &log_result);
-    s1.set_stats_print_interval(1, 0);
+    s1.set_stats_print_interval(0);
     s1.grow();
     EXPECT_EQ(Counters::get_min_ratio(), Fraction(3, 2));
   }
@@ -149,16 +162,440 @@ TEST(GrowerTest, WithLogging) {
     Counters::initialize();
     GrowerTk s1(2, true, false, false, 0, 0, false, Fraction(1E8, 1));
     s1.set_logging(&log, &log_detail, &log_result);
-    s1.set_stats_print_interval(1, 0);
+    s1.set_stats_print_interval(0);
     s1.grow();
     EXPECT_EQ(Counters::get_min_ratio(), Fraction(3, 1));
   }
 }
 
+TEST(GrowerTest, Monitor) {
+  // The monitor thread prints the progress, and the totals once the workers are done.
+  Graph::set_global_graph_info(3, 5);
+  for (int num_threads : {0, 3}) {
+    std::stringstream log;
+    Counters::initialize();
+    GrowerTk s(num_threads, false, true, true, 0, 0);
+    s.set_logging(&log, nullptr, nullptr);
+    s.set_stats_print_interval(0);
+    s.grow();
+    const std::string totals =
+        "Final step: " + std::to_string(s.get_results().size()) + " base graphs done, ";
+    EXPECT_NE(log.str().find(totals), std::string::npos);
+    const std::string idle =
+        num_threads == 0 ? "  Workers: 0: idle\n" : "  Workers: 0: idle, 1: idle, 2: idle\n";
+    EXPECT_EQ(log.str().substr(log.str().size() - idle.size()), idle);
+  }
+}
+
+TEST(GrowerTest, PerfLog) {
+  // The perf log has one line for each base graph, with the work done on all its ranges.
+  Graph::set_global_graph_info(3, 5);
+  for (int num_threads : {0, 3}) {
+    std::stringstream perf;
+    Counters::initialize();
+    GrowerTk s(num_threads, false, true, true, 0, 0);
+    s.set_logging(nullptr, nullptr, nullptr, &perf);
+    s.grow();
+    std::set<int> base_graph_ids;
+    for (std::string line; std::getline(perf, line);) {
+      int base_graph_id;
+      unsigned long long graphs, edge_sets, enum_states;
+      ASSERT_EQ(sscanf(line.c_str(), "{\"base_graph_id\":%d,", &base_graph_id), 1) << line;
+      ASSERT_EQ(sscanf(line.substr(line.find("\"graphs\"")).c_str(),
+                       "\"graphs\":%llu,\"edge_sets\":%llu,\"enum_states\":%llu,", &graphs,
+                       &edge_sets, &enum_states),
+                3)
+          << line;
+      EXPECT_LE(graphs, edge_sets);
+      EXPECT_LE(edge_sets, enum_states);
+      EXPECT_TRUE(base_graph_ids.insert(base_graph_id).second);
+      EXPECT_EQ(line.back(), '}');
+    }
+    std::set<int> result_ids;
+    for (const auto& r : s.get_results()) result_ids.insert(std::get<0>(r));
+    EXPECT_EQ(base_graph_ids, result_ids);
+  }
+}
+
 TEST(GrowerTest, StartEndIndex) {
   Graph::set_global_graph_info(2, 3);
   Counters::initialize();
   GrowerTk s(0, false, false, false, 0, 1);
   s.grow();
   EXPECT_EQ(Counters::get_min_ratio(), Fraction(3, 2));
-}
\ No newline at end of file
+}
+TEST(GrowerTest, Estimate) {
+  Graph::set_global_graph_info(2, 5);
+  Counters::initialize();
+  GrowerTk s(0, false, true, true, 0, 0);
+  s.set_estimate_probes(20);
+  s.grow();
+  // The final enumeration is not performed, and each base graph gets an estimate.
+  EXPECT_TRUE(s.get_results().empty());
+  const auto& estimates = s.get_estimates();
+  ASSERT_EQ(estimates.size(), 57);
+  for (size_t i = 0; i < estimates.size(); i++) {
+    EXPECT_EQ(std::get<0>(estimates[i]), i);
+    EXPECT_GE(std::get<1>(estimates[i]), 1);
+    EXPECT_GE(std::get<2>(estimates[i]), 0);
+  }
+}
+
+TEST(GrowerTest, MinDegreeFilter) {
+  // The min degree filter finds the same min theta with fewer graphs.
+  std::vector<std::tuple<int, int, Fraction>> cases = {{2, 5, Fraction(5, 3)},
+                                                       {2, 6, Fraction(5, 3)},
+                                                       {3, 5, Fraction(5, 3)},
+                                                       {4, 5, Fraction(5, 4)}};
+  for (const auto& [k, n, min_theta] : cases) {
+    Graph::set_global_graph_info(k, n);
+    for (int num_threads : {0, 3}) {
+      Counters::initialize();
+      GrowerTk s(num_threads, false, true, true, 0, 0);
+      s.set_min_degree_filter(true);
+      s.grow();
+      EXPECT_EQ(Counters::get_min_ratio(), min_theta);
+    }
+  }
+}
+
+TEST(GrowerTest, LongestFirst) {
+  // Processing the most expensive base graphs first gives the same result for each base graph.
+  std::vector<std::pair<int, int>> cases = {{2, 5}, {2, 6}, {3, 5}, {4, 5}};
+  for (const auto& [k, n] : cases) {
+    Graph::set_global_graph_info(k, n);
+    for (int num_threads : {0, 3}) {
+      Counters::initialize();
+      GrowerTk s1(num_threads, false, true, true, 0, 0);
+      s1.grow();
+      const Fraction min_theta = Counters::get_min_ratio();
+      Counters::initialize();
+      GrowerTk s2(num_threads, false, true, true, 0, 0);
+      s2.set_longest_first(10);
+      s2.grow();
+      EXPECT_EQ(Counters::get_min_ratio(), min_theta);
+      verify_array_equal(s1.get_results(), s2.get_results());
+    }
+  }
+}
+
+TEST(GrowerTest, Checkpoint) {
+  // Stopping the final enumeration phase and resuming it from the checkpoint, until it completes,
+  // gives the same result for each base graph as an uninterrupted run.
+  const std::string path = testing::TempDir() + "grower_test_checkpoint";
+  // The resumed runs take the levels from the growth snapshot, so the stop request hits the final
+  // enumeration phase. Otherwise grow() stops before growing the levels.
+  const std::string snapshot_dir = testing::TempDir() + "grower_test_checkpoint_snapshots";
+  std::filesystem::create_directories(snapshot_dir);
+  std::vector<std::pair<int, int>> cases = {{3, 5}, {4, 5}};
+  for (const auto& [k, n] : cases) {
+    Graph::set_global_graph_info(k, n);
+    for (int num_threads : {0, 3}) {
+      for (bool adaptive : {false, true}) {
+        auto set_options = [adaptive](GrowerTk& s) {
+          s.set_candidate_order(adaptive ? CandidateOrder::ADAPTIVE : CandidateOrder::ASCENDING);
+        };
+        Counters::initialize();
+        GrowerTk s1(num_threads, false, true, true, 0, 0);
+        set_options(s1);
+        s1.set_growth_snapshot(snapshot_dir);
+        s1.grow();
+        const Fraction min_theta = Counters::get_min_ratio();
+
+        std::remove(path.c_str());
+        int runs = 0;
+        while (true) {
+          Counters::initialize();
+          GrowerTk s2(num_threads, false, true, true, 0, 0);
+          set_options(s2);
+          s2.set_growth_snapshot(snapshot_dir);
+          s2.set_checkpoint(path, 1000, true);
+          // Each worker thread stops after its first batch.
+          GrowerBase::request_stop();
+          s2.grow();
+          GrowerBase::clear_stop_request();
+          ++runs;
+          if (!s2.is_interrupted()) {
+            EXPECT_EQ(Counters::get_min_ratio(), min_theta);
+            verify_array_equal(s1.get_results(), s2.get_results());
+            break;
+          }
+        }
+        EXPECT_GT(runs, 2);
+      }
+    }
+  }
+  std::remove(path.c_str());
+  std::filesystem::remove_all(snapshot_dir);
+}
+
+TEST(GrowerTest, CheckpointMismatch) {
+  // A checkpoint is only resumed by the same search.
+  const std::string path = testing::TempDir() + "grower_test_checkpoint_mismatch";
+  // The stopped runs take the levels from the growth snapshots written by the complete runs.
+  const std::string snapshot_dir = testing::TempDir() + "grower_test_checkpoint_mismatch_snapshots";
+  std::filesystem::create_directories(snapshot_dir);
+  Graph::set_global_graph_info(3, 5);
+  std::remove(path.c_str());
+  Counters::initialize();
+  GrowerTk g1(0, true, true, true, 0, 0);
+  g1.set_orderly_generation(true);
+  g1.set_growth_snapshot(snapshot_dir);
+  g1.grow();
+  Counters::initialize();
+  GrowerTk s1(0, false, true, true, 0, 0);
+  s1.set_orderly_generation(true);
+  s1.set_growth_snapshot(snapshot_dir);
+  s1.set_checkpoint(path, 1000, true);
+  GrowerBase::request_stop();
+  s1.grow();
+  GrowerBase::clear_stop_request();
+  ASSERT_TRUE(s1.is_interrupted());
+
+  // The levels have the same sizes, but the base graph ids point to other graphs.
+  Counters::initialize();
+  GrowerTk s2(0, false, true, true, 0, 0);
+  s2.set_growth_snapshot(snapshot_dir);
+  s2.set_checkpoint(path, 1000, true);
+  s2.grow();
+  EXPECT_TRUE(s2.is_interrupted());
+  EXPECT_TRUE(s2.get_results().empty());
+
+  // The same for a checkpoint of the search with the minimum degree filter.
+  std::remove(path.c_str());
+  Counters::initialize();
+  GrowerTk s3(0, false, true, true, 0, 0);
+  s3.set_min_degree_filter(true);
+  s3.set_growth_snapshot(snapshot_dir);
+  s3.set_checkpoint(path, 1000, true);
+  GrowerBase::request_stop();
+  s3.grow();
+  GrowerBase::clear_stop_request();
+  ASSERT_TRUE(s3.is_interrupted());
+
+  Counters::initialize();
+  GrowerTk s4(0, false, true, true, 0, 0);
+  s4.set_checkpoint(path, 1000, true);
+  s4.grow();
+  EXPECT_TRUE(s4.is_interrupted());
+  EXPECT_TRUE(s4.get_results().empty());
+  std::remove(path.c_str());
+  std::filesystem::remove_all(snapshot_dir);
+}
+
+TEST(GrowerTest, StopInGrowthPhase) {
+  // A stop request in the growth phase stops before the next level, without a checkpoint.
+  const std::string path = testing::TempDir() + "grower_test_growth_stop";
+  Graph::set_global_graph_info(3, 5);
+  std::remove(path.c_str());
+  Counters::initialize();
+  GrowerTk s(0, false, true, true, 0, 0);
+  s.set_checkpoint(path, 1000, true);
+  GrowerBase::request_stop();
+  s.grow();
+  GrowerBase::clear_stop_request();
+  EXPECT_TRUE(s.is_interrupted());
+  EXPECT_TRUE(s.get_results().empty());
+  EXPECT_FALSE(std::filesystem::exists(path));
+}
+
+TEST(GrowerTest, GrowthSnapshot) {
+  // Starting from the growth snapshot of the same N, a larger N or a smaller N gives the same
+  // results as growing all levels.
+  const std::string dir = testing::TempDir();
+  std::vector<std::pair<int, std::vector<int>>> cases = {{2, {5, 6, 6, 4}}, {3, {4, 5, 5}}};
+  auto remove_snapshots = [&dir](int k) {
+    Graph::set_global_graph_info(k, k + 1);
+    for (int n = k + 1; n <= MAX_VERTICES; n++) {
+      std::remove(GrowthSnapshot::get_path(dir, "tk", n).c_str());
+    }
+  };
+  for (const auto& [k, orders] : cases) {
+    remove_snapshots(k);
+    for (int n : orders) {
+      Graph::set_global_graph_info(k, n);
+      Counters::initialize();
+      GrowerTk s1(0, false, true, true, 0, 0);
+      s1.grow();
+      const Fraction min_theta = Counters::get_min_ratio();
+
+      Counters::initialize();
+      GrowerTk s2(0, false, true, true, 0, 0);
+      s2.set_growth_snapshot(dir);
+      s2.grow();
+      EXPECT_EQ(Counters::get_min_ratio(), min_theta);
+      verify_array_equal(s1.get_results(), s2.get_results());
+
+      GrowthSnapshot snapshot;
+      ASSERT_TRUE(snapshot.open(dir, "tk"));
+      EXPECT_EQ(snapshot.get_max_order(), n - 1);
+      EXPECT_FALSE(snapshot.open(dir, "k4"));
+    }
+    remove_snapshots(k);
+  }
+}
+
+TEST(GrowerTest, GrowthSnapshotOtherN) {
+  // The levels read from the snapshot of a larger or a smaller N are the same as the levels grown
+  // with the current N, id for id, so that the base graph ids of the batches and checkpoints are
+  // the same with or without the snapshot.
+  const std::string dir = testing::TempDir() + "grower_test_snapshot_other_n";
+  for (const auto& [k, orders] : {std::make_pair(2, std::vector<int>{4, 7, 5, 6}),
+                                  std::make_pair(3, std::vector<int>{4, 6, 5})}) {
+    // The snapshot of each N is grown in its own directory.
+    for (int n : orders) {
+      const std::string n_dir = dir + "/" + std::to_string(n);
+      std::filesystem::create_directories(n_dir);
+      Graph::set_global_graph_info(k, n);
+      Counters::initialize();
+      GrowerTk g(0, true, true, true, 0, 0);
+      g.set_growth_snapshot(n_dir);
+      g.grow();
+    }
+    for (int n : orders) {
+      Graph::set_global_graph_info(k, n);
+      GrowthSnapshot grown;
+      ASSERT_TRUE(grown.open(dir + "/" + std::to_string(n), "tk"));
+      for (int other_n : orders) {
+        if (other_n == n) continue;
+        GrowthSnapshot other;
+        ASSERT_TRUE(other.open(dir + "/" + std::to_string(other_n), "tk"));
+        ASSERT_EQ(other.get_n(), other_n);
+        for (int order = k - 1; order <= other.get_max_order(); order++) {
+          std::vector<Graph> expected, actual;
+          grown.read_level(order, expected);
+          other.read_level(order, actual);
+          ASSERT_EQ(expected.size(), actual.size());
+          for (size_t i = 0; i < expected.size(); i++) {
+            ASSERT_EQ(expected[i].serialize_edges(), actual[i].serialize_edges())
+                << "K=" << k << " N=" << n << " snapshot N=" << other_n << " order=" << order
+                << " id=" << i;
+          }
+        }
+      }
+    }
+  }
+  std::filesystem::remove_all(dir);
+}
+
+TEST(GrowerTest, GrowthSpill) {
+  // Spilling the growth steps with a small memory budget collects the same graphs as in memory.
+  // With the budget of one graph, every candidate is spilled, and each partition is sorted in
+  // runs of one record through several merge passes.
+  const std::string dir = testing::TempDir() + "grower_test_spill";
+  std::filesystem::create_directories(dir);
+  for (const auto& [k, n] : {std::make_pair(2, 6), std::make_pair(3, 5)}) {
+    Graph::set_global_graph_info(k, n);
+    // The growth phase observes the graphs in the same order, so it finds the same min ratio
+    // graph. The final phase is skipped, since its threads complete the base graphs in any order.
+    Counters::initialize();
+    GrowerTk g1(2, true, true, true, 0, 0);
+    g1.grow();
+    const std::string min_theta_graph = Counters::get_min_ratio_graph().serialize_edges();
+
+    Counters::initialize();
+    GrowerTk s1(2, false, true, true, 0, 0);
+    s1.grow();
+    const Fraction min_theta = Counters::get_min_ratio();
+
+    for (uint64 budget : {20 * sizeof(Graph), sizeof(Graph)}) {
+      Counters::initialize();
+      GrowerTk g2(2, true, true, true, 0, 0);
+      g2.set_growth_spill(dir, budget);
+      g2.grow();
+      EXPECT_EQ(Counters::get_min_ratio_graph().serialize_edges(), min_theta_graph);
+
+      Counters::initialize();
+      GrowerTk s2(2, false, true, true, 0, 0);
+      s2.set_growth_spill(dir, budget);
+      s2.grow();
+      EXPECT_EQ(Counters::get_min_ratio(), min_theta);
+      // The min theta graphs of the base graphs may differ among the ties with multiple threads.
+      const auto& r1 = s1.get_results();
+      const auto& r2 = s2.get_results();
+      ASSERT_EQ(r1.size(), r2.size());
+      for (size_t i = 0; i < r1.size(); i++) {
+        EXPECT_EQ(std::get<0>(r1[i]), std::get<0>(r2[i]));
+        EXPECT_EQ(std::get<1>(r1[i]).serialize_edges(), std::get<1>(r2[i]).serialize_edges());
+      }
+      // The spill files are removed.
+      EXPECT_TRUE(std::filesystem::is_empty(dir));
+    }
+  }
+  std::filesystem::remove_all(dir);
+}
+
+TEST(GrowerTest, OrderlyGeneration) {
+  // The orderly generation collects one graph of each isomorphism class like the hash set, and
+  // the results don't depend on the number of threads.
+  for (const auto& [k, n] : {std::make_pair(2, 6), std::make_pair(3, 5), std::make_pair(4, 6)}) {
+    Graph::set_global_graph_info(k, n);
+    Counters::initialize();
+    GrowerTk s1(0, false, true, true, 0, 0);
+    s1.grow();
+    const Fraction min_theta = Counters::get_min_ratio();
+
+    std::vector<std::tuple<int, Graph, Graph>> orderly_results;
+    for (int num_threads : {0, 3}) {
+      Counters::initialize();
+      GrowerTk s2(num_threads, false, true, true, 0, 0);
+      s2.set_orderly_generation(true);
+      s2.grow();
+      EXPECT_EQ(Counters::get_min_ratio(), min_theta);
+      const auto& r1 = s1.get_results();
+      const auto& r2 = s2.get_results();
+      ASSERT_EQ(r1.size(), r2.size());
+      // Each base graph is isomorphic to exactly one of the other run.
+      for (const auto& [id, base, min_ratio_graph] : r2) {
+        int matches = 0;
+        for (const auto& r : r1) matches += std::get<1>(r).is_isomorphic(base);
+        EXPECT_EQ(matches, 1);
+      }
+      if (num_threads == 0) {
+        orderly_results = r2;
+      } else {
+        for (size_t i = 0; i < r2.size(); i++) {
+          EXPECT_EQ(std::get<1>(r2[i]).serialize_edges(),
+                    std::get<1>(orderly_results[i]).serialize_edges());
+        }
+      }
+    }
+  }
+}
+
+TEST(GrowerTest, Coordinator) {
+  // The coordinator collects the same results from the worker processes as the final
+  // enumeration phase. The search takes seconds, so that both workers connect before the first
+  // one completes all base graphs, even if the other one just missed the coordinator's start.
+  Graph::set_global_graph_info(3, 6);
+  Counters::initialize();
+  GrowerTk s1(0, false, true, true, 0, 0);
+  s1.grow();
+  const Fraction min_theta = Counters::get_min_ratio();
+
+  const std::string address = testing::TempDir() + "grower_test_coordinator";
+  std::vector<pid_t> workers;
+  std::cout.flush();
+  for (int num_threads : {0, 2}) {
+    const pid_t pid = fork();
+    if (pid == 0) {
+      Counters::initialize();
+      GrowerTk worker(num_threads, false, true, true, 0, 0);
+      worker.set_worker(address);
+      worker.grow();
+      _exit(worker.is_interrupted() ? 1 : 0);
+    }
+    workers.push_back(pid);
+  }
+  Counters::initialize();
+  GrowerTk s2(0, false, true, true, 0, 0);
+  s2.set_coordinator(address);
+  s2.grow();
+  EXPECT_EQ(Counters::get_min_ratio(), min_theta);
+  verify_array_equal(s1.get_results(), s2.get_results());
+  for (pid_t pid : workers) {
+    int status;
+    ASSERT_EQ(waitpid(pid, &status, 0), pid);
+    EXPECT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+  }
+}
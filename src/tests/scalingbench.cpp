@@ -0,0 +1,75 @@
+// A benchmark of the final enumeration phase with each number of worker threads and placement
+// policy (see `PlacementPolicy`).
+//
+// Usage: scalingbench [K N [max_threads]], by default 3 6 and the number of available CPUs.
+//
+// The base graphs are grown once into a growth snapshot, so every run only times the final
+// enumeration phase. The results of all runs must match. For each run the wall time, the speedup
+// over one thread without pinning, and the efficiency (speedup / threads) are printed.
+
+#include "../counters.h"
+#include "../cpu_topology.h"
+#include "../forbid_tk/graph_tk.h"
+
+// Runs the search, and returns the number of seconds it takes.
+double run(int threads, PlacementPolicy placement, const std::string& snapshot_dir,
+           std::vector<std::tuple<int, Graph, Graph>>& results) {
+  Counters::initialize();
+  GrowerTk s(threads, false, true, true, 0, 0);
+  s.set_growth_snapshot(snapshot_dir);
+  s.set_placement(placement);
+  const auto start = std::chrono::steady_clock::now();
+  s.grow();
+  const auto end = std::chrono::steady_clock::now();
+  results = s.get_results();
+  // The threads complete the base graphs in any order.
+  std::sort(results.begin(), results.end(),
+            [](const auto& a, const auto& b) { return std::get<0>(a) < std::get<0>(b); });
+  return std::chrono::duration<double>(end - start).count();
+}
+
+int main(int argc, char* argv[]) {
+  const CpuTopology topology = CpuTopology::detect();
+  const int k = argc > 2 ? atoi(argv[1]) : 3;
+  const int n = argc > 2 ? atoi(argv[2]) : 6;
+  const int max_threads = argc > 3 ? atoi(argv[3]) : topology.get_available_cpu_count();
+  Graph::set_global_graph_info(k, n);
+
+  char dir_template[] = "/tmp/scalingbench_XXXXXX";
+  const std::string snapshot_dir = mkdtemp(dir_template);
+  std::vector<std::tuple<int, Graph, Graph>> expected, actual;
+  // Grow the base graphs into the snapshot.
+  run(1, PlacementPolicy::NONE, snapshot_dir, expected);
+
+  std::cout << "K=" << k << ", N=" << n << ", " << topology.get_available_cpu_count()
+            << " CPUs available on " << topology.get_node_count() << " NUMA nodes\n";
+  printf("%8s %8s %10s %8s %10s\n", "threads", "pin", "seconds", "speedup", "efficiency");
+  const double base_seconds = run(1, PlacementPolicy::NONE, snapshot_dir, expected);
+  const std::vector<std::pair<PlacementPolicy, const char*>> policies = {
+      {PlacementPolicy::NONE, "none"},
+      {PlacementPolicy::COMPACT, "compact"},
+      {PlacementPolicy::SCATTER, "scatter"}};
+  // Double the threads up to max_threads.
+  for (int threads = 1; threads <= max_threads;
+       threads = threads == max_threads ? threads + 1 : std::min(threads * 2, max_threads)) {
+    for (const auto& [placement, name] : policies) {
+      const double seconds = run(threads, placement, snapshot_dir, actual);
+      if (actual.size() != expected.size()) {
+        std::cout << "The results don't match\n";
+        return -1;
+      }
+      for (size_t i = 0; i < actual.size(); i++) {
+        if (std::get<0>(actual[i]) != std::get<0>(expected[i]) ||
+            std::get<2>(actual[i]).get_theta_ratio() !=
+                std::get<2>(expected[i]).get_theta_ratio()) {
+          std::cout << "The results don't match\n";
+          return -1;
+        }
+      }
+      printf("%8d %8s %10.3f %8.2f %10.2f\n", threads, name, seconds, base_seconds / seconds,
+             base_seconds / seconds / threads);
+    }
+  }
+  std::filesystem::remove_all(snapshot_dir);
+  return 0;
+}